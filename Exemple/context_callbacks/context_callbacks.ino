@@ -0,0 +1,89 @@
+#include <FLOlib_Floker.h>
+
+// In-process server, no WiFi or real server is needed
+Mock_transport mock_server("token");
+
+Floker broker(
+  "ssid",
+  "password",
+  false,
+  "localhost",
+  "/api/",
+  "token",
+  "house"
+);
+
+// 1) Function with a context: the same function serves several channels without globals
+struct Room
+{
+  const char *name;
+  unsigned long nb_changes;
+};
+
+Room kitchen = {"kitchen", 0};
+Room bedroom = {"bedroom", 0};
+
+void room_callback(void *context, const Channel & /* channel */, State_view state, State_view old_state) {
+  Room *room = static_cast<Room *>(context);
+  room->nb_changes++;
+
+  // The views are only valid during the call, nothing is copied
+  Serial.print(room->name);
+  Serial.print(": ");
+  Serial.print(old_state.data);
+  Serial.print(" -> ");
+  Serial.println(state.data);
+}
+
+// 2) Member function
+class Heater
+{
+public:
+  bool on = false;
+
+  void on_state(const Channel &channel, State_view state, State_view /* old_state */) {
+    this->on = state.equals("ON");
+    Serial.println(String("Heater ") + (this->on ? "on" : "off") + " (" + channel.topic_path + ")");
+  }
+};
+
+Heater heater;
+
+unsigned long nb_door_openings = 0;
+
+// 3) Lambda or functor given by address, it must live as long as the subscription
+auto door_callback = [](const Channel & /* channel */, State_view state, State_view old_state) {
+  if (state.equals("OPEN") && !old_state.equals("OPEN"))
+    nb_door_openings++;
+};
+
+void setup() {
+  Serial.begin(DEFAULT_SERIAL_BAUDRATE);
+
+  broker.set_transport(&mock_server);
+
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/kitchen"), "19.5");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/bedroom"), "18.0");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/heater"), "OFF");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/door"), "CLOSED");
+
+  broker.subscribe("/kitchen", room_callback, &kitchen);
+  broker.subscribe("/bedroom", room_callback, &bedroom);
+  broker.subscribe<Heater, &Heater::on_state>("/heater", &heater);
+  broker.subscribe("/door", &door_callback);
+
+  broker.begin();
+}
+
+void loop() {
+  broker.handle();
+
+  // Server side changes
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/kitchen"), String(19 + random(0, 4)));
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/heater"), random(0, 2) ? "ON" : "OFF");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/door"), random(0, 2) ? "OPEN" : "CLOSED");
+
+  Serial.println("Kitchen changes: " + String(kitchen.nb_changes) + ", door openings: " + String(nb_door_openings));
+
+  delay(1000);
+}
@@ -0,0 +1,59 @@
+#include <FLOlib_Floker.h>
+
+// Number of subscribed channels to benchmark
+#define NB_CHANNELS 40
+#define NB_HANDLE_CYCLES 100
+
+// In-process server, no WiFi or real server is needed
+Mock_transport mock_server("token");
+
+Floker broker(
+  "ssid",
+  "password",
+  false,
+  "localhost",
+  "/api/",
+  "token",
+  "bench"
+);
+
+unsigned long nb_callbacks = 0;
+
+void count_callback(String /* data */){
+  nb_callbacks++;
+}
+
+void setup() {
+  Serial.begin(DEFAULT_SERIAL_BAUDRATE);
+
+  // All the requests are sent to the mock server
+  broker.set_transport(&mock_server);
+
+  for (unsigned short k = 0; k < NB_CHANNELS; k++)
+  {
+    String topic = "/channel_" + String(k);
+    mock_server.set_state(DEFAULT_START_IOT_PATH + String("bench") + topic, "0");
+    broker.subscribe(topic, count_callback);
+  }
+
+  broker.begin();
+}
+
+void loop() {
+  unsigned long start = micros();
+  for (unsigned short k = 0; k < NB_HANDLE_CYCLES; k++)
+  {
+    // Change one channel every cycle to fire a callback
+    mock_server.set_state(DEFAULT_START_IOT_PATH + String("bench/channel_") + String(k % NB_CHANNELS), String(k));
+    broker.handle();
+  }
+  unsigned long duration = micros() - start;
+
+  Serial.println("Channels: " + String(NB_CHANNELS));
+  Serial.println("Handle average duration (us): " + String(duration / NB_HANDLE_CYCLES));
+  Serial.println("Callbacks fired: " + String(nb_callbacks));
+  Serial.println("Get requests: " + String(mock_server.nb_get_requests));
+  Serial.println("Post requests: " + String(mock_server.nb_post_requests));
+
+  delay(5000);
+}
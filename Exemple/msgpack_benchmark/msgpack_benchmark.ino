@@ -0,0 +1,109 @@
+#include <FLOlib_Floker.h>
+
+// Number of subscribed channels to benchmark
+#define NB_CHANNELS 40
+#define NB_PARSE_LOOPS 100
+#define NB_HANDLE_CYCLES 100
+
+// In-process server, no WiFi or real server is needed
+Mock_transport mock_server("token");
+
+Floker broker(
+  "ssid",
+  "password",
+  false,
+  "localhost",
+  "/api/",
+  "token",
+  "bench"
+);
+
+unsigned long nb_callbacks = 0;
+
+void count_callback(String /* data */){
+  nb_callbacks++;
+}
+
+// Size and parse time of a multi response in JSON and in compact MessagePack
+void encoding_benchmark() {
+  DynamicJsonDocument json_response(NB_CHANNELS * DEFAULT_UNDER_RESPONSE_SIZE);
+  JsonArray responses = json_response.to<JsonArray>();
+  for (unsigned short k = 0; k < NB_CHANNELS; k++)
+  {
+    JsonObject response = responses.createNestedObject();
+    response["data"] = String(k * 10);
+    response["status"] = 200;
+  }
+
+  DynamicJsonDocument json_compact_response(NB_CHANNELS * DEFAULT_UNDER_RESPONSE_SIZE);
+  Json_tools::compact_responses(responses, json_compact_response.to<JsonArray>());
+
+  String json;
+  serializeJson(json_response, json);
+  String msgpack;
+  if (!Json_tools::to_msgpack(json_compact_response, &msgpack)) {
+    Serial.println("Not enough memory to encode the response.");
+    return;
+  }
+
+  DynamicJsonDocument json_parsed(NB_CHANNELS * DEFAULT_UNDER_RESPONSE_SIZE);
+  unsigned long start = micros();
+  for (unsigned short k = 0; k < NB_PARSE_LOOPS; k++)
+    deserializeJson(json_parsed, json.c_str(), json.length());
+  unsigned long json_duration = micros() - start;
+
+  start = micros();
+  for (unsigned short k = 0; k < NB_PARSE_LOOPS; k++)
+    deserializeMsgPack(json_parsed, msgpack.c_str(), msgpack.length());
+  unsigned long msgpack_duration = micros() - start;
+
+  Serial.println("Response bytes JSON / MessagePack: " + String(json.length()) + " / " + String(msgpack.length()));
+  Serial.println("Parse average duration JSON / MessagePack (us): " + String(json_duration / NB_PARSE_LOOPS) + " / " + String(msgpack_duration / NB_PARSE_LOOPS));
+}
+
+// Bytes on the wire and handle duration with the mock server
+void handle_benchmark(bool enable_msgpack) {
+  broker.set_msgpack(enable_msgpack);
+  mock_server.nb_bytes_sent = 0;
+  mock_server.nb_bytes_received = 0;
+
+  unsigned long start = micros();
+  for (unsigned short k = 0; k < NB_HANDLE_CYCLES; k++)
+  {
+    // Change one channel every cycle to fire a callback
+    mock_server.set_state(DEFAULT_START_IOT_PATH + String("bench/channel_") + String(k % NB_CHANNELS), String(k));
+    broker.handle();
+  }
+  unsigned long duration = micros() - start;
+
+  Serial.println(enable_msgpack ? "MessagePack:" : "JSON:");
+  Serial.println("  Handle average duration (us): " + String(duration / NB_HANDLE_CYCLES));
+  Serial.println("  Request bytes per cycle: " + String(mock_server.nb_bytes_sent / NB_HANDLE_CYCLES));
+  Serial.println("  Response bytes per cycle: " + String(mock_server.nb_bytes_received / NB_HANDLE_CYCLES));
+}
+
+void setup() {
+  Serial.begin(DEFAULT_SERIAL_BAUDRATE);
+
+  // All the requests are sent to the mock server
+  broker.set_transport(&mock_server);
+
+  for (unsigned short k = 0; k < NB_CHANNELS; k++)
+  {
+    String topic = "/channel_" + String(k);
+    mock_server.set_state(DEFAULT_START_IOT_PATH + String("bench") + topic, "0");
+    broker.subscribe(topic, count_callback);
+  }
+
+  broker.begin();
+}
+
+void loop() {
+  Serial.println("Channels: " + String(NB_CHANNELS));
+  encoding_benchmark();
+  handle_benchmark(false);
+  handle_benchmark(true);
+  Serial.println("Callbacks fired: " + String(nb_callbacks));
+
+  delay(5000);
+}
@@ -0,0 +1,65 @@
+#include <FLOlib_Floker.h>
+
+// In-process server, no WiFi or real server is needed
+Mock_transport mock_server("token");
+
+Floker broker(
+  "ssid",
+  "password",
+  false,
+  "localhost",
+  "/api/",
+  "token",
+  "greenhouse"
+);
+
+float temperature = 21.0;
+
+void setpoint_callback(float setpoint) {
+  Serial.println("Setpoint: " + String(setpoint));
+}
+
+void humidity_callback(int humidity) {
+  Serial.println("Humidity: " + String(humidity));
+}
+
+void setup() {
+  Serial.begin(DEFAULT_SERIAL_BAUDRATE);
+
+  broker.set_transport(&mock_server);
+  broker.set_buffered_write(true);
+
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("greenhouse/setpoint"), "21.0");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("greenhouse/humidity"), "60");
+
+  // The filters are set on typed channels, after the subscribe
+  broker.subscribe("/setpoint", setpoint_callback);
+  broker.subscribe("/humidity", humidity_callback);
+  // Only the moves of more than 0.5, 1.0 when the setpoint goes back
+  broker.set_read_filter("/setpoint", 0.5, 1.0);
+  // At most one callback every 10 s
+  broker.set_read_filter("/humidity", 0, 0, 10000);
+
+  // The temperature is sent when it moves more than 0.2, and at least every minute
+  broker.set_write_filter("/temperature", 0.2, 60000);
+
+  broker.begin();
+}
+
+void loop() {
+  // Noisy sensor: most of the samples are not sent
+  temperature += random(-10, 11) / 100.0;
+  broker.write_value("/temperature", temperature, 1);
+
+  // Noisy server side values
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("greenhouse/setpoint"), String(21.0 + random(-8, 9) / 10.0, 1));
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("greenhouse/humidity"), String(60 + random(-3, 4)));
+
+  broker.handle();
+
+  Metrics *metrics = broker.get_metrics();
+  Serial.println("Callbacks: " + String(metrics->nb_callbacks) + ", filtered: " + String(metrics->nb_filtered_callbacks) +
+                 ", filtered writes: " + String(metrics->nb_filtered_writes));
+
+  delay(1000);
+}
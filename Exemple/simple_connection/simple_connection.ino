@@ -1,5 +1,5 @@
 
-#include "FLOlib_floker.h" 
+#include <FLOlib_Floker.h>
 
 Floker broker(
   /*WiFi ssid*/, 
@@ -0,0 +1,141 @@
+#include <FLOlib_Floker.h>
+
+// Define FLOKER_STATIC_MEMORY (and the FLOKER_MAX_* / FLOKER_*_SIZE capacities) as compiler flags
+// of all the files: handle() doesn't allocate from the first cycle, else only once its buffers have grown
+#define NB_CHANNELS 8
+#define NB_CYCLES 10000
+
+#ifdef HOST_ENABLED
+// Count the heap allocations (glibc)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t nb, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+unsigned long nb_allocations = 0;
+extern "C" void *malloc(size_t size) { nb_allocations++; return __libc_malloc(size); }
+extern "C" void *calloc(size_t nb, size_t size) { nb_allocations++; return __libc_calloc(nb, size); }
+extern "C" void *realloc(void *ptr, size_t size) { nb_allocations++; return __libc_realloc(ptr, size); }
+#endif
+
+// Serve the multi responses from memory, only the library side of the cycles is measured
+class Static_transport : public Transport
+{
+public:
+  // Two responses with different states, they alternate on every cycle
+  String responses[2];
+  unsigned short current = 0;
+  String_stream response_stream;
+
+  int get(const char * /* uri */, String * /* response */) { return 404; }
+  int post(const char * /* uri */, const String & /* request */, String * /* response */) { return 404; }
+  int post_stream(const char *uri, const String &request, Stream **response_stream)
+  {
+    this->current = 1 - this->current;
+    this->response_stream.set_string(&this->responses[this->current]);
+    *response_stream = &this->response_stream;
+    this->nb_bytes_sent += strlen(uri) + request.length();
+    return 200;
+  }
+  void end_stream() {}
+  bool need_wifi() { return false; }
+};
+
+Static_transport static_transport;
+
+Floker broker(
+  "ssid",
+  "password",
+  false,
+  "localhost",
+  "/api/",
+  "token",
+  "test"
+);
+
+unsigned long nb_callbacks = 0;
+
+// The state is given in place, without String copy
+void count_callback(const char * /* data */) {
+  nb_callbacks++;
+}
+
+void setup() {
+  Serial.begin(DEFAULT_SERIAL_BAUDRATE);
+
+  // The debug messages build Strings
+  Floker_log::level = FLOKER_LOG_LEVEL_WARNING;
+
+  broker.set_transport(&static_transport);
+  broker.set_buffered_write(true);
+
+  for (unsigned short k = 0; k < NB_CHANNELS; k++)
+    broker.subscribe("/channel_" + String(k), count_callback);
+
+  for (unsigned short k = 0; k < 2; k++)
+  {
+    static_transport.responses[k] = "[";
+    for (unsigned short c = 0; c < NB_CHANNELS; c++)
+    {
+      if (c > 0)
+        static_transport.responses[k] += ",";
+      static_transport.responses[k] += "{\"data\":\"state_" + String(c) + "_" + String(k) + "\",\"status\":200}";
+    }
+    static_transport.responses[k] += "]";
+  }
+
+  broker.begin();
+
+#ifndef FLOKER_STATIC_MEMORY
+  // The buffers grow during the first cycles (with a buffered write, like the measured ones)
+  broker.write("/command", "on");
+  broker.handle();
+  broker.write("/command", "off");
+  broker.handle();
+#endif
+}
+
+void loop() {
+  unsigned long free_heap = Metrics::get_free_heap();
+  unsigned long largest_block = Metrics::get_largest_block();
+  unsigned long nb_callbacks_before = nb_callbacks;
+#ifdef HOST_ENABLED
+  unsigned long allocations = 0;
+#endif
+
+  for (unsigned short k = 0; k < NB_CYCLES; k++)
+  {
+    // Buffered write, sent with the next multi request
+    broker.write("/command", (k % 2 == 0) ? "on" : "off");
+
+#ifdef HOST_ENABLED
+    unsigned long nb_allocations_before = nb_allocations;
+    broker.handle();
+    allocations += nb_allocations - nb_allocations_before;
+#else
+    broker.handle();
+#endif
+  }
+
+  // The responses alternate: every channel changes on every cycle
+  unsigned long callbacks = nb_callbacks - nb_callbacks_before;
+  bool success = (callbacks == (unsigned long)NB_CYCLES * NB_CHANNELS);
+
+  Serial.println("Cycles: " + String(NB_CYCLES) + ", callbacks: " + String(callbacks) + " (expected " + String((unsigned long)NB_CYCLES * NB_CHANNELS) + ")");
+  Serial.println("Free heap difference: " + String((long)(Metrics::get_free_heap() - free_heap)));
+  Serial.println("Largest block difference: " + String((long)(Metrics::get_largest_block() - largest_block)));
+#ifdef HOST_ENABLED
+  Serial.println("Heap allocations in handle(): " + String(allocations));
+  success = success && allocations == 0;
+#endif
+  Serial.println(success ? "OK" : "FAIL");
+
+#ifdef HOST_ENABLED
+  // Exit status checked by ctest
+  if (!success)
+  {
+    Serial.flush();
+    exit(1);
+  }
+#endif
+
+  delay(5000);
+}
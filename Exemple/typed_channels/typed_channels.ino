@@ -0,0 +1,72 @@
+#include <FLOlib_Floker.h>
+
+// In-process server, no WiFi or real server is needed
+Mock_transport mock_server("token");
+
+Floker broker(
+  "ssid",
+  "password",
+  false,
+  "localhost",
+  "/api/",
+  "token",
+  "house"
+);
+
+// The callbacks get the parsed value, only when it changes ("21.5" then "21.50" doesn't call it)
+void temperature_callback(float temperature) {
+  Serial.println("Temperature: " + String(temperature));
+}
+
+void brightness_callback(int brightness) {
+  Serial.println("Brightness: " + String(brightness));
+}
+
+// "1", "true" and "on" (any case) are true
+void light_callback(bool on) {
+  Serial.println(on ? "Light on" : "Light off");
+}
+
+// The state is one of the names, the callback gets the enum value of its index
+enum Mode
+{
+  AUTO,
+  MANUAL,
+  AWAY
+};
+const char *const mode_names[] = {"auto", "manual", "away"};
+
+void mode_callback(Mode mode) {
+  Serial.println(String("Mode: ") + mode_names[mode]);
+}
+
+void setup() {
+  Serial.begin(DEFAULT_SERIAL_BAUDRATE);
+
+  broker.set_transport(&mock_server);
+
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/temperature"), "21.5");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/brightness"), "80");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/light"), "OFF");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/mode"), "auto");
+
+  // The type is deduced from the callback, it can also be given: subscribe<float>(...)
+  broker.subscribe("/temperature", temperature_callback);
+  broker.subscribe("/brightness", brightness_callback);
+  broker.subscribe("/light", light_callback);
+  broker.subscribe("/mode", mode_callback, mode_names, 3);
+
+  broker.begin();
+}
+
+void loop() {
+  broker.handle();
+
+  // Server side changes, the same values written differently don't call the callbacks
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/temperature"), random(0, 2) ? "21.5" : "21.50");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/brightness"), String(random(0, 3) * 40));
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/light"), random(0, 2) ? "ON" : "1");
+  mock_server.set_state(DEFAULT_START_IOT_PATH + String("house/mode"), mode_names[random(0, 3)]);
+
+  delay(1000);
+}
@@ -0,0 +1,112 @@
+#include <FLOlib_Floker.h>
+
+#define NB_CALLS 1000
+
+#ifdef HOST_ENABLED
+// Count the heap allocations (glibc)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+unsigned long nb_allocations = 0;
+extern "C" void *malloc(size_t size) { nb_allocations++; return __libc_malloc(size); }
+extern "C" void *realloc(void *ptr, size_t size) { nb_allocations++; return __libc_realloc(ptr, size); }
+#endif
+
+// Answer every request without network or response, only the library side of the call is measured
+class Null_transport : public Transport
+{
+public:
+  int get(const char * /* uri */, String * /* response */) { return 200; }
+  int post(const char * /* uri */, const String & /* request */, String * /* response */) { return 200; }
+  bool need_wifi() { return false; }
+};
+
+Null_transport null_transport;
+
+Server_Manager server(
+  "ssid",
+  "password",
+  HTTP_REQUEST,
+  "localhost",
+  HTTP_PORT,
+  "/api/",
+  "token"
+);
+
+// Topic and state longer than the String small buffer, with characters to encode
+String topic = DEFAULT_START_IOT_PATH + String("bench/living_room/temperature");
+String state = "21.5 C & rising";
+String response;
+
+// URI built by String concatenations, as done before the Uri_builder
+void string_uri_benchmark() {
+  unsigned long start = micros();
+#ifdef HOST_ENABLED
+  unsigned long allocations = nb_allocations;
+#endif
+  unsigned long length = 0;
+  for (unsigned short k = 0; k < NB_CALLS; k++)
+  {
+    String uri = String(HTTP_REQUEST) + String("localhost") + String(":") + String(HTTP_PORT) + String("/api/");
+    uri += String("write?");
+    uri += String("token=") + String("token");
+    uri += String("&topic=") + topic;
+    uri += String("&state=") + state;
+    length += uri.length();
+  }
+  unsigned long duration = micros() - start;
+#ifdef HOST_ENABLED
+  allocations = nb_allocations - allocations;
+#endif
+
+  Serial.println("String concatenation:");
+  Serial.println("  URI length: " + String(length / NB_CALLS));
+  Serial.println("  Average duration (us): " + String((float)duration / NB_CALLS));
+#ifdef HOST_ENABLED
+  Serial.println("  Heap allocations per URI: " + String((float)allocations / NB_CALLS));
+#endif
+}
+
+// read() and write() with the Uri_builder
+void request_benchmark(bool write) {
+  unsigned long free_heap = Metrics::get_free_heap();
+  unsigned long start = micros();
+#ifdef HOST_ENABLED
+  unsigned long allocations = nb_allocations;
+#endif
+  for (unsigned short k = 0; k < NB_CALLS; k++)
+  {
+    if (write)
+      server.write(topic, state);
+    else
+      server.read(topic, &response);
+  }
+  unsigned long duration = micros() - start;
+#ifdef HOST_ENABLED
+  allocations = nb_allocations - allocations;
+#endif
+
+  Serial.println(write ? "write():" : "read():");
+  Serial.println("  Average duration (us): " + String((float)duration / NB_CALLS));
+  Serial.println("  Free heap difference: " + String((long)(Metrics::get_free_heap() - free_heap)));
+#ifdef HOST_ENABLED
+  Serial.println("  Heap allocations per call: " + String((float)allocations / NB_CALLS));
+#endif
+}
+
+void setup() {
+  Serial.begin(DEFAULT_SERIAL_BAUDRATE);
+
+  // The debug messages build Strings on every request
+  Floker_log::level = FLOKER_LOG_LEVEL_WARNING;
+
+  server.set_transport(&null_transport);
+  server.begin();
+}
+
+void loop() {
+  string_uri_benchmark();
+  request_benchmark(false);
+  request_benchmark(true);
+
+  delay(5000);
+}
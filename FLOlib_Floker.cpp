@@ -1,4 +1,85 @@
-#include "FLOlib_floker.h"
+#include "FLOlib_Floker.h"
+
+#include <utility>
+
+#ifdef HOST_ENABLED
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+// Configuration of the library build, see FLOKER_CONFIG_SYMBOL
+const unsigned char FLOKER_CONFIG_SYMBOL = 0;
+// The URI length is an unsigned short
+static_assert(DEFAULT_URI_SIZE > 0 && DEFAULT_URI_SIZE <= 65535, "DEFAULT_URI_SIZE must fit in an unsigned short");
+
+#pragma region Log
+Floker_log_sink Floker_log::sink = Floker_log::serial_sink;
+unsigned short Floker_log::max_messages = 0;
+unsigned long Floker_log::interval = 0;
+unsigned long Floker_log::window_start = 0;
+unsigned short Floker_log::nb_messages = 0;
+unsigned long Floker_log::nb_dropped = 0;
+unsigned char Floker_log::level = FLOKER_LOG_LEVEL;
+
+// Private method(s)
+void Floker_log::serial_sink(unsigned char /* level */, const String &message)
+{
+    Serial.println(message);
+}
+
+// Public method(s)
+void Floker_log::set_sink(Floker_log_sink sink)
+{
+    Floker_log::sink = (sink != NULL) ? sink : Floker_log::serial_sink;
+}
+
+void Floker_log::set_rate_limit(unsigned short max_messages, unsigned long interval)
+{
+    Floker_log::max_messages = max_messages;
+    Floker_log::interval = interval;
+    Floker_log::window_start = millis();
+    Floker_log::nb_messages = 0;
+}
+
+bool Floker_log::accept(unsigned char level)
+{
+    if (level > Floker_log::level)
+        return false;
+    if (Floker_log::max_messages == 0)
+        return true;
+
+    // New window: report the messages dropped in the previous one
+    if (millis() - Floker_log::window_start >= Floker_log::interval)
+    {
+        Floker_log::window_start = millis();
+        Floker_log::nb_messages = 0;
+        if (Floker_log::nb_dropped > 0)
+        {
+            Floker_log::nb_messages++;
+            Floker_log::sink(FLOKER_LOG_LEVEL_WARNING, String(Floker_log::nb_dropped) + String(" log message(s) dropped"));
+            Floker_log::nb_dropped = 0;
+        }
+    }
+
+    if (Floker_log::nb_messages >= Floker_log::max_messages)
+    {
+        Floker_log::nb_dropped++;
+        return false;
+    }
+
+    Floker_log::nb_messages++;
+    return true;
+}
+
+void Floker_log::write(unsigned char level, const String &message)
+{
+    Floker_log::sink(level, message);
+}
+#pragma endregion
 
 #pragma region Json_tools
 void Json_tools::merge_json(JsonObject dest, JsonObject src)
@@ -20,6 +101,143 @@ DynamicJsonDocument Json_tools::make_task_json(String type, String topic, Dynami
     return json;
 }
 
+void Json_tools::add_read_task(JsonArray tasks, const String &topic)
+{
+    JsonObject task = tasks.createNestedObject();
+    task["type"] = "read";
+    task["topic"] = topic;
+    task["parse"] = "state";
+}
+
+void Json_tools::add_write_task(JsonArray tasks, const String &topic, const String &state)
+{
+    JsonObject task = tasks.createNestedObject();
+    task["type"] = "write";
+    task["topic"] = topic;
+    task["state"] = state;
+}
+
+void Json_tools::add_watch_task(JsonArray tasks, const String &topic, const String &state)
+{
+    JsonObject task = tasks.createNestedObject();
+    task["type"] = "read";
+    task["topic"] = topic;
+    task["parse"] = "state";
+    task["state"] = state;
+}
+
+const char *Json_tools::get_text(JsonVariantConst value, String *buffer)
+{
+    if (value.is<const char *>())
+        return value.as<const char *>();
+
+    *buffer = "";
+    serializeJson(value, *buffer);
+    return buffer->c_str();
+}
+
+void Json_tools::compact_tasks(JsonArray tasks, JsonArray compact_tasks)
+{
+    for (JsonVariant task : tasks)
+    {
+        JsonArray compact_task = compact_tasks.createNestedArray();
+        compact_task.add(task["type"].as<String>() == String("write") ? FLOKER_WRITE_TASK : FLOKER_READ_TASK);
+        compact_task.add(task["topic"]);
+        if (!task["state"].isNull())
+            compact_task.add(task["state"]);
+    }
+}
+
+void Json_tools::expand_tasks(JsonArray compact_tasks, JsonArray tasks)
+{
+    for (JsonVariant compact_task : compact_tasks)
+    {
+        JsonObject task = tasks.createNestedObject();
+        bool write = (compact_task[0].as<int>() == FLOKER_WRITE_TASK);
+        task["type"] = write ? "write" : "read";
+        task["topic"] = compact_task[1];
+        if (!write)
+            task["parse"] = "state";
+        if (compact_task.size() > 2)
+            task["state"] = compact_task[2];
+    }
+}
+
+void Json_tools::compact_responses(JsonArray responses, JsonArray compact_responses)
+{
+    for (JsonVariant response : responses)
+    {
+        JsonArray compact_response = compact_responses.createNestedArray();
+        compact_response.add(response["data"]);
+        compact_response.add(response["status"]);
+        if (!response["index"].isNull())
+            compact_response.add(response["index"]);
+    }
+}
+
+void Json_tools::expand_responses(JsonArray compact_responses, JsonArray responses)
+{
+    for (JsonVariant compact_response : compact_responses)
+    {
+        JsonObject response = responses.createNestedObject();
+        response["data"] = compact_response[0];
+        response["status"] = compact_response[1];
+        if (compact_response.size() > 2)
+            response["index"] = compact_response[2];
+    }
+}
+
+bool Json_tools::to_msgpack(const JsonDocument &json, String *msgpack)
+{
+    size_t size = measureMsgPack(json);
+    char *buffer = (char *)malloc(size);
+    if (buffer == NULL)
+        return false;
+    serializeMsgPack(json, buffer, size);
+
+    // Appended with its length, the binary data contains '\0'
+    *msgpack = String("");
+    bool success = msgpack->concat(buffer, size);
+    free(buffer);
+    return success;
+}
+
+bool Json_tools::read_msgpack_array_header(Stream *stream, unsigned long *size)
+{
+    uint8_t header;
+    if (stream->readBytes((char *)&header, 1) != 1)
+        return false;
+
+    // fixarray: the size is in the header
+    if ((header & 0xF0) == 0x90)
+    {
+        *size = header & 0x0F;
+        return true;
+    }
+
+    // array 16 and array 32: big-endian size after the header
+    uint8_t nb_size_bytes = (header == 0xDC) ? 2 : (header == 0xDD) ? 4 : 0;
+    uint8_t size_bytes[4];
+    if (nb_size_bytes == 0 || stream->readBytes((char *)size_bytes, nb_size_bytes) != nb_size_bytes)
+        return false;
+
+    *size = 0;
+    for (uint8_t k = 0; k < nb_size_bytes; k++)
+        *size = (*size << 8) | size_bytes[k];
+    return true;
+}
+
+char Json_tools::read_separator(Stream *stream)
+{
+    char c;
+    do
+    {
+        if (stream->readBytes(&c, 1) != 1)
+            return 0;
+    } while (c == ' ' || c == '\n' || c == '\r' || c == '\t');
+    return c;
+}
+
 DynamicJsonDocument Json_tools::make_read_json(String topic)
 {
     DynamicJsonDocument json_params(256);
@@ -42,446 +260,3824 @@ Channel::Channel(String topic_path, void (*function)(String data), String state)
 {
     this->topic_path = topic_path;
     this->function = function;
+#ifdef FLOKER_STATIC_MEMORY
+    // The state is updated in place
+    this->state.reserve(FLOKER_STATE_SIZE);
+#endif
     this->state = state;
+    this->topic_hash = Channel::hash_topic(topic_path);
+    this->poll_period = 0;
+    this->next_poll = millis();
 }
 
 // Static: Method(s)
-Channel Channel::deep_copy(Channel channel_to_copy)
+unsigned long Channel::hash_topic(const String &topic)
+{
+    // FNV-1a 32 bits
+    unsigned long hash = 2166136261UL;
+    for (unsigned int k = 0; k < topic.length(); k++)
+    {
+        hash ^= (unsigned char)topic.charAt(k);
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+bool Channel::parse_value(const char *state, Channel_value *value) const
 {
-    return Channel(channel_to_copy.topic_path, channel_to_copy.function, channel_to_copy.state);
+    char *end;
+    switch (this->type)
+    {
+    case INT_VALUE:
+        value->integer = strtol(state, &end, 10);
+        return end != state;
+    case FLOAT_VALUE:
+        value->real = strtof(state, &end);
+        return end != state;
+    case BOOL_VALUE:
+        value->boolean = (strcasecmp(state, "true") == 0 || strcasecmp(state, "on") == 0 || strtol(state, NULL, 10) != 0);
+        return true;
+    case ENUM_VALUE:
+        for (unsigned short k = 0; k < this->nb_enum_names; k++)
+            if (strcmp(state, this->enum_names[k]) == 0)
+            {
+                value->integer = k;
+                return true;
+            }
+        return false;
+    default:
+        return false;
+    }
 }
 
-Channel *Channel::push_channel_to_array(Channel *old_ptr, Channel channel_to_push, unsigned short new_size)
+bool Channel::accept_value(Channel_value value)
 {
-    Channel *new_ptr;
+    unsigned long now = millis();
+    signed char direction = 0;
+    this->held = false;
 
-    // If no element in the array
-    if (new_size - 1 == 0)
+    if (this->has_value)
     {
-        if (DEBUG_FLOKER_LIB)
+        if (this->is_same_value(value))
+            return false;
+
+        if (this->min_interval != 0 && now - this->last_notify < this->min_interval)
         {
-            Serial.println("\nSubscribe to a new channel, this is the first one !");
-            Serial.println("Let's alloc the memory.");
+            this->held = true;
+            return false;
         }
 
-        new_ptr = (Channel *)calloc(new_size, sizeof(Channel));
-    }
-    else
-    {
-        if (DEBUG_FLOKER_LIB)
+        if (this->type == INT_VALUE || this->type == FLOAT_VALUE)
         {
-            Serial.println("\nSubscribe to a new channel, this the seconde one or more !");
-            Serial.println("Let's alloc the memory.");
+            float delta = (this->type == INT_VALUE) ? (float)(value.integer - this->value.integer) : value.real - this->value.real;
+            direction = (delta > 0) ? 1 : -1;
+
+            // Going back needs a larger move: the noise around a turning point is not notified
+            float band = this->deadband;
+            if (this->last_direction != 0 && direction != this->last_direction && this->hysteresis > band)
+                band = this->hysteresis;
+
+            if (fabs(delta) <= band)
+                return false;
         }
+    }
+
+    this->value = value;
+    this->has_value = true;
+    this->last_notify = now;
+    if (direction != 0)
+        this->last_direction = direction;
+    return true;
+}
+
+bool Channel::is_same_value(Channel_value value) const
+{
+    switch (this->type)
+    {
+    case FLOAT_VALUE:
+        return value.real == this->value.real;
+    case BOOL_VALUE:
+        return value.boolean == this->value.boolean;
+    default:
+        return value.integer == this->value.integer;
+    }
+}
+
+// Channel_registry
+// Destructor
+Channel_registry::~Channel_registry()
+{
+    for (unsigned short k = 0; k < this->nb_channels; k++)
+        this->channels[k].~Channel();
+    free(this->channels);
+    free(this->index_table);
+}
+
+// Private method(s)
+bool Channel_registry::grow(unsigned short new_capacity)
+{
+    FLOKER_LOG_DEBUG("\nGrow the channels registry to " + String(new_capacity) + " channels.");
+
+    // Keep the index at most half full
+    unsigned short new_index_size = 8;
+    while (new_index_size < 2 * new_capacity)
+        new_index_size *= 2;
+
+    // The old tables are kept if the new ones can't be allocated
+    Channel *new_channels = (Channel *)malloc(new_capacity * sizeof(Channel));
+    unsigned short *new_index_table = (unsigned short *)calloc(new_index_size, sizeof(unsigned short));
+    if (new_channels == NULL || new_index_table == NULL)
+    {
+        FLOKER_LOG_ERROR("Not enough memory to grow the channels registry to " + String(new_capacity) + " channels.");
+        free(new_channels);
+        free(new_index_table);
+        return false;
+    }
+
+    // Move the channels in the new memory
+    for (unsigned short k = 0; k < this->nb_channels; k++)
+    {
+        new (&new_channels[k]) Channel(std::move(this->channels[k]));
+        this->channels[k].~Channel();
+    }
+    free(this->channels);
+    this->channels = new_channels;
+    this->capacity = new_capacity;
+
+    free(this->index_table);
+    this->index_table = new_index_table;
+    this->index_size = new_index_size;
+
+    for (unsigned short k = 0; k < this->nb_channels; k++)
+        this->index_table[this->find_free_slot(this->channels[k].topic_hash)] = k + 1;
+
+    return true;
+}
+
+int Channel_registry::find_slot(const String &topic, unsigned long hash)
+{
+    if (this->index_size == 0)
+        return -1;
+
+    unsigned short mask = this->index_size - 1;
+    for (unsigned short slot = hash & mask; this->index_table[slot] != 0; slot = (slot + 1) & mask)
+    {
+        Channel &channel = this->channels[this->index_table[slot] - 1];
+        if (channel.topic_hash == hash && channel.topic_path == topic)
+            return slot;
+    }
+    return -1;
+}
 
-        new_ptr = (Channel *)calloc(new_size, sizeof(Channel));
+unsigned short Channel_registry::find_free_slot(unsigned long hash)
+{
+    unsigned short mask = this->index_size - 1;
+    unsigned short slot = hash & mask;
+    while (this->index_table[slot] != 0)
+        slot = (slot + 1) & mask;
+    return slot;
+}
 
-        if (DEBUG_FLOKER_LIB)
+void Channel_registry::erase_slot(unsigned short slot)
+{
+    // Backward shift deletion to keep the linear probing chains unbroken
+    unsigned short mask = this->index_size - 1;
+    unsigned short next = slot;
+    while (true)
+    {
+        this->index_table[slot] = 0;
+        while (true)
         {
-            Serial.println("New channels adress: " + String((unsigned long)new_ptr));
-            Serial.println("Current channels adress: " + String((unsigned long)old_ptr));
+            next = (next + 1) & mask;
+            if (this->index_table[next] == 0)
+                return;
+
+            unsigned short home = this->channels[this->index_table[next] - 1].topic_hash & mask;
+            bool in_chain = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+            if (!in_chain)
+                break;
         }
+        this->index_table[slot] = this->index_table[next];
+        slot = next;
+    }
+}
+
+// Public method(s)
+bool Channel_registry::reserve(unsigned short capacity)
+{
+    if (capacity > this->capacity)
+        return this->grow(capacity);
+    return true;
+}
+
+Channel *Channel_registry::add(String topic_path, void (*function)(String data), String state)
+{
+    unsigned long hash = Channel::hash_topic(topic_path);
+
+    // Already subscribed, update the callback function
+    int slot = this->find_slot(topic_path, hash);
+    if (slot >= 0)
+    {
+        Channel *channel = &this->channels[this->index_table[slot] - 1];
+        channel->function = function;
+        return channel;
+    }
+
+#ifdef FLOKER_STATIC_MEMORY
+    // Fixed capacity, allocated with the first channel
+    if (this->nb_channels == this->capacity && this->capacity > 0)
+        return NULL;
+    if (this->capacity == 0 && !this->grow(FLOKER_MAX_CHANNELS))
+        return NULL;
+#else
+    // Geometric growth
+    if (this->nb_channels == this->capacity && !this->grow((this->capacity == 0) ? DEFAULT_CHANNELS_CAPACITY : this->capacity * 2))
+        return NULL;
+#endif
+
+    Channel *channel = new (&this->channels[this->nb_channels]) Channel(topic_path, function, state);
+    this->index_table[this->find_free_slot(hash)] = this->nb_channels + 1;
+    this->nb_channels++;
+    this->version++;
+
+    return channel;
+}
+
+bool Channel_registry::remove(String topic_path)
+{
+    int slot = this->find_slot(topic_path, Channel::hash_topic(topic_path));
+    if (slot < 0)
+        return false;
+
+    unsigned short index = this->index_table[slot] - 1;
+    unsigned short last = this->nb_channels - 1;
+    this->erase_slot(slot);
+
+    // Move the last channel in the hole
+    if (index != last)
+    {
+        unsigned short mask = this->index_size - 1;
+        unsigned short last_slot = this->channels[last].topic_hash & mask;
+        while (this->index_table[last_slot] != last + 1)
+            last_slot = (last_slot + 1) & mask;
+        this->index_table[last_slot] = index + 1;
+
+        this->channels[index] = std::move(this->channels[last]);
+    }
+
+    this->channels[last].~Channel();
+    this->nb_channels--;
+    this->version++;
+
+    return true;
+}
+
+Channel *Channel_registry::find(const String &topic_path)
+{
+    int slot = this->find_slot(topic_path, Channel::hash_topic(topic_path));
+    return (slot < 0) ? NULL : &this->channels[this->index_table[slot] - 1];
+}
+
+// Poll_scheduler
+// Destructor
+Poll_scheduler::~Poll_scheduler()
+{
+    free(this->heap);
+}
+
+// Private method(s)
+bool Poll_scheduler::before(Channel_registry *channels, unsigned short a, unsigned short b)
+{
+    // Wrap-around safe comparison of the due times
+    return (long)((*channels)[this->heap[a]].next_poll - (*channels)[this->heap[b]].next_poll) < 0;
+}
+
+void Poll_scheduler::swap(unsigned short a, unsigned short b)
+{
+    unsigned short index = this->heap[a];
+    this->heap[a] = this->heap[b];
+    this->heap[b] = index;
+}
+
+void Poll_scheduler::sift_up(Channel_registry *channels, unsigned short position)
+{
+    while (position > 0)
+    {
+        unsigned short parent = (position - 1) / 2;
+        if (!this->before(channels, position, parent))
+            break;
+        this->swap(position, parent);
+        position = parent;
+    }
+}
+
+void Poll_scheduler::sift_down(Channel_registry *channels, unsigned short position)
+{
+    while (true)
+    {
+        unsigned short smallest = position;
+        unsigned short left = 2 * position + 1;
+        unsigned short right = left + 1;
+
+        if (left < this->heap_size && this->before(channels, left, smallest))
+            smallest = left;
+        if (right < this->heap_size && this->before(channels, right, smallest))
+            smallest = right;
+        if (smallest == position)
+            break;
+
+        this->swap(position, smallest);
+        position = smallest;
+    }
+}
+
+void Poll_scheduler::push(Channel_registry *channels, unsigned short index)
+{
+    this->heap[this->heap_size] = index;
+    this->heap_size++;
+    this->sift_up(channels, this->heap_size - 1);
+}
+
+// Public method(s)
+void Poll_scheduler::reserve(unsigned short capacity)
+{
+    if (this->capacity >= capacity)
+        return;
+
+    free(this->heap);
+    this->capacity = capacity;
+    this->heap = (unsigned short *)malloc(this->capacity * sizeof(unsigned short));
+}
 
-        for (unsigned short k = 0; k < new_size - 1; k++)
-            new_ptr[k] = Channel::deep_copy(old_ptr[k]);
+void Poll_scheduler::update(Channel_registry *channels)
+{
+    if (!this->dirty && this->version == channels->version)
+        return;
+
+    this->reserve(channels->size());
 
-        free(old_ptr);
+    // Heapify all the channels
+    this->heap_size = channels->size();
+    for (unsigned short k = 0; k < this->heap_size; k++)
+        this->heap[k] = k;
+    for (int k = this->heap_size / 2 - 1; k >= 0; k--)
+        this->sift_down(channels, k);
+
+    this->version = channels->version;
+    this->dirty = false;
+}
 
-        if (DEBUG_FLOKER_LIB)
-            Serial.println("The deep copy is done.");
+unsigned short Poll_scheduler::pop_due(Channel_registry *channels, unsigned long now, unsigned short *due_indexes)
+{
+    // Take all the due channels from the top of the heap
+    unsigned short nb_due = 0;
+    while (this->heap_size > 0 && (long)(now - (*channels)[this->heap[0]].next_poll) >= 0)
+    {
+        due_indexes[nb_due++] = this->heap[0];
+        this->heap_size--;
+        this->heap[0] = this->heap[this->heap_size];
+        this->sift_down(channels, 0);
     }
-    Serial.println("The new current channels adress: " + String((unsigned long)new_ptr));
 
-    // Add the new channel to the new_ptr
-    new_ptr[new_size - 1] = Channel::deep_copy(channel_to_push);
+    // Schedule their next poll
+    for (unsigned short k = 0; k < nb_due; k++)
+    {
+        Channel &channel = (*channels)[due_indexes[k]];
+        channel.next_poll = now + channel.poll_period;
+        this->push(channels, due_indexes[k]);
+    }
 
-    return new_ptr;
+    return nb_due;
 }
 #pragma endregion
 
-// Server
-#pragma region Server
-// Constructor
-Server_Manager::Server_Manager(
-    const char *ssid,
-    const char *password,
-    String request_type,
-    String server,
-    unsigned short port,
-    String root_path,
-    String token,
-    String device_path)
+#pragma region Write_queue
+// Destructor
+Write_queue::~Write_queue()
 {
-    this->ssid = ssid;
-    this->password = password;
-    this->request_type = request_type;
-    this->server = server;
-    this->port = port;
-    this->root_path = root_path;
-    this->token = token;
-    this->device_path = device_path;
+    delete[] this->writes;
 }
 
 // Private method(s)
-String Server_Manager::make_uri(String topic, String data_to_write)
+int Write_queue::find(const String &topic_path, unsigned long hash)
+{
+    for (unsigned short k = 0; k < this->nb_writes; k++)
+        if (this->writes[k].topic_hash == hash && this->writes[k].topic_path == topic_path)
+            return k;
+    return -1;
+}
+
+// Public method(s)
+void Write_queue::reserve(unsigned short capacity)
+{
+    if (capacity <= this->capacity)
+        return;
+
+    // The slots are kept between the flushes
+    Pending_write *new_writes = new Pending_write[capacity];
+    for (unsigned short k = 0; k < this->nb_writes; k++)
+        new_writes[k] = std::move(this->writes[k]);
+#ifdef FLOKER_STATIC_MEMORY
+    // The writes are copied in place
+    for (unsigned short k = this->nb_writes; k < capacity; k++)
+    {
+        new_writes[k].topic_path.reserve(FLOKER_TOPIC_SIZE);
+        new_writes[k].state.reserve(FLOKER_STATE_SIZE);
+    }
+#endif
+    delete[] this->writes;
+    this->writes = new_writes;
+    this->capacity = capacity;
+}
+
+bool Write_queue::push(const String &topic_path, const String &state)
+{
+#ifdef FLOKER_STATIC_MEMORY
+    if (topic_path.length() >= FLOKER_TOPIC_SIZE || state.length() >= FLOKER_STATE_SIZE)
+        return false;
+#endif
+
+    // A newer value replace the pending one
+    unsigned long hash = Channel::hash_topic(topic_path);
+    int index = this->find(topic_path, hash);
+    if (index >= 0)
+    {
+        this->writes[index].state = state;
+        return true;
+    }
+
+#ifdef FLOKER_STATIC_MEMORY
+    // Fixed capacity, allocated with the first write
+    if (this->nb_writes == this->capacity && this->capacity > 0)
+        return false;
+    this->reserve(FLOKER_MAX_WRITES);
+#else
+    // Geometric growth
+    if (this->nb_writes == this->capacity)
+        this->reserve((this->capacity == 0) ? DEFAULT_WRITE_QUEUE_CAPACITY : this->capacity * 2);
+#endif
+
+    this->writes[this->nb_writes].topic_path = topic_path;
+    this->writes[this->nb_writes].state = state;
+    this->writes[this->nb_writes].topic_hash = hash;
+    this->nb_writes++;
+    return true;
+}
+
+void Write_queue::add_tasks(JsonArray tasks)
+{
+    for (unsigned short k = 0; k < this->nb_writes; k++)
+        Json_tools::add_write_task(tasks, this->writes[k].topic_path, this->writes[k].state);
+}
+
+void Write_queue::swap(Write_queue *other)
+{
+    Pending_write *writes = this->writes;
+    unsigned short nb_writes = this->nb_writes;
+    unsigned short capacity = this->capacity;
+
+    this->writes = other->writes;
+    this->nb_writes = other->nb_writes;
+    this->capacity = other->capacity;
+
+    other->writes = writes;
+    other->nb_writes = nb_writes;
+    other->capacity = capacity;
+}
+
+void Write_queue::restore(Write_queue *older)
+{
+    // The values pushed since are newer, keep them
+    for (unsigned short k = 0; k < older->nb_writes; k++)
+        if (this->find(older->writes[k].topic_path, older->writes[k].topic_hash) < 0)
+            this->push(older->writes[k].topic_path, older->writes[k].state);
+    older->clear();
+}
+
+void Write_queue::erase_front(unsigned short nb_writes)
+{
+    if (nb_writes >= this->nb_writes)
+    {
+        this->clear();
+        return;
+    }
+
+    // Swapped, the String buffers stay in the queue
+    for (unsigned short k = nb_writes; k < this->nb_writes; k++)
+        std::swap(this->writes[k - nb_writes], this->writes[k]);
+    this->nb_writes -= nb_writes;
+}
+
+bool Write_queue::remove(const String &topic_path)
+{
+    int index = this->find(topic_path, Channel::hash_topic(topic_path));
+    if (index < 0)
+        return false;
+
+    // The order of the other writes is kept
+    for (unsigned short k = index + 1; k < this->nb_writes; k++)
+        std::swap(this->writes[k - 1], this->writes[k]);
+    this->nb_writes--;
+    return true;
+}
+
+void Write_queue::clear()
+{
+    this->nb_writes = 0;
+}
+#pragma endregion
+
+#pragma region Write_filters
+// Destructor
+Write_filters::~Write_filters()
+{
+    delete[] this->filters;
+}
+
+// Public method(s)
+void Write_filters::set(const String &topic_path, float deadband, unsigned long max_age)
+{
+    Write_filter *filter = this->find(topic_path);
+    if (filter == NULL)
+    {
+        // Geometric growth, the filters are set at the start
+        if (this->nb_filters == this->capacity)
+        {
+            unsigned short new_capacity = (this->capacity == 0) ? DEFAULT_WRITE_FILTERS_CAPACITY : this->capacity * 2;
+            Write_filter *new_filters = new Write_filter[new_capacity];
+            for (unsigned short k = 0; k < this->nb_filters; k++)
+                new_filters[k] = std::move(this->filters[k]);
+            delete[] this->filters;
+            this->filters = new_filters;
+            this->capacity = new_capacity;
+        }
+
+        filter = &this->filters[this->nb_filters];
+        filter->topic_path = topic_path;
+        filter->topic_hash = Channel::hash_topic(topic_path);
+        filter->written = false;
+        this->nb_filters++;
+    }
+
+    filter->deadband = deadband;
+    filter->max_age = max_age;
+}
+
+Write_filter *Write_filters::find(const String &topic_path)
+{
+    unsigned long hash = Channel::hash_topic(topic_path);
+    for (unsigned short k = 0; k < this->nb_filters; k++)
+        if (this->filters[k].topic_hash == hash && this->filters[k].topic_path == topic_path)
+            return &this->filters[k];
+    return NULL;
+}
+
+bool Write_filters::accept(Write_filter *filter, float value)
+{
+    if (!filter->written)
+        return true;
+
+    if (filter->max_age != 0 && millis() - filter->written_at >= filter->max_age)
+        return true;
+
+    return fabs(value - filter->value) > filter->deadband;
+}
+
+void Write_filters::written(Write_filter *filter, float value)
+{
+    filter->value = value;
+    filter->written_at = millis();
+    filter->written = true;
+}
+#pragma endregion
+
+#pragma region Transport
+// String_stream
+// Public method(s)
+void String_stream::set_string(String *string)
+{
+    this->string = string;
+    this->position = 0;
+
+    // All the data is already in memory, don't wait for more
+    this->setTimeout(0);
+}
+
+int String_stream::available()
+{
+    return (this->string == NULL) ? 0 : this->string->length() - this->position;
+}
+
+int String_stream::read()
+{
+    return (this->available() > 0) ? (unsigned char)this->string->charAt(this->position++) : -1;
+}
+
+int String_stream::peek()
+{
+    return (this->available() > 0) ? (unsigned char)this->string->charAt(this->position) : -1;
+}
+
+size_t String_stream::write(uint8_t c)
+{
+    if (this->string == NULL)
+        return 0;
+
+    this->string->concat((char)c);
+    return 1;
+}
+
+// Transport
+// Public method(s)
+int Transport::post_stream(const char *uri, const String &request, Stream **response_stream)
+{
+    // Default behaviour: buffer the whole response and stream it from memory
+    int http_code = this->post(uri, request, &this->stream_buffer);
+    this->buffer_stream.set_string(&this->stream_buffer);
+    *response_stream = &this->buffer_stream;
+    return http_code;
+}
+
+void Transport::end_stream()
+{
+    this->buffer_stream.set_string(NULL);
+    this->stream_buffer = String("");
+}
+
+int Transport::start_post(const char *uri, const String &request)
+{
+    // Default behaviour: the request is done at once, the response is given by the next poll
+    this->async_http_code = this->post(uri, request, &this->stream_buffer);
+    return (this->async_http_code < 0) ? this->async_http_code : 0;
+}
+
+int Transport::poll_response(String *response)
+{
+    *response = this->stream_buffer;
+    this->stream_buffer = String("");
+    return this->async_http_code;
+}
+
+int Transport::poll_event(String *data)
+{
+    if (this->events_http_code == 200 && this->next_event(data))
+        return 200;
+
+    // Read a bounded amount of bytes on each call
+    char chunk[DEFAULT_ASYNC_READ_SIZE];
+    int nb_read = this->read_events(chunk, sizeof(chunk));
+    if (nb_read < 0 || (nb_read == 0 && millis() - this->events_last_read > DEFAULT_PUSH_TIMEOUT))
+    {
+        this->close_events();
+        return FLOKER_EVENTS_CLOSED;
+    }
+
+    if (nb_read > 0)
+    {
+        this->events_last_read = millis();
+        this->nb_bytes_received += nb_read;
+    }
+    for (int k = 0; k < nb_read; k++)
+        if (chunk[k] != '\r')
+            this->events_buffer += chunk[k];
+
+    // Status line and headers
+    if (this->events_http_code == 0)
+    {
+        int headers_end = this->events_buffer.indexOf("\n\n");
+        if (headers_end < 0)
+            return FLOKER_PENDING;
+
+        int status_start = this->events_buffer.indexOf(' ');
+        this->events_http_code = (status_start < 0 || status_start > headers_end) ? FLOKER_EVENTS_CLOSED : this->events_buffer.substring(status_start + 1).toInt();
+        this->events_buffer.remove(0, headers_end + 2);
+
+        if (this->events_http_code != 200)
+        {
+            this->close_events();
+            return (this->events_http_code > 0) ? this->events_http_code : FLOKER_EVENTS_CLOSED;
+        }
+    }
+
+    return this->next_event(data) ? 200 : FLOKER_PENDING;
+}
+
+void Transport::split_uri(const char *uri, String *host, String *port, String *path)
+{
+    // scheme://host:port/path
+    String url(uri);
+    int host_start = url.indexOf("://");
+    host_start = (host_start < 0) ? 0 : host_start + 3;
+    int path_start = url.indexOf('/', host_start);
+    if (path_start < 0)
+        path_start = url.length();
+
+    *host = url.substring(host_start, path_start);
+    *path = (path_start < (int)url.length()) ? url.substring(path_start) : String("/");
+    *port = String(HTTP_PORT);
+
+    int port_start = host->indexOf(':');
+    if (port_start >= 0)
+    {
+        *port = host->substring(port_start + 1);
+        *host = host->substring(0, port_start);
+    }
+}
+
+String Transport::make_raw_request(String method, String host, String path, const String *request, bool keep_alive)
+{
+    String raw_request = method + String(" ") + path + String(" HTTP/1.1\r\n");
+    raw_request += String("Host: ") + host + String("\r\n");
+    raw_request += keep_alive ? String("Connection: keep-alive\r\n") : String("Connection: close\r\n");
+    if (this->if_none_match != String(""))
+        raw_request += String("If-None-Match: ") + this->if_none_match + String("\r\n");
+    if (request != NULL)
+    {
+        raw_request += String("Content-Type: ") + this->content_type + String("\r\n");
+        raw_request += String("Accept: ") + this->content_type + String("\r\n");
+        raw_request += String("Content-Length: ") + String(request->length()) + String("\r\n");
+    }
+    raw_request += String("\r\n");
+    if (request != NULL)
+        raw_request += *request;
+
+    return raw_request;
+}
+
+String Transport::make_events_request(String host, String path)
+{
+    // HTTP/1.0: the server streams the events without chunked encoding
+    String raw_request = String("GET ") + path + String(" HTTP/1.0\r\n");
+    raw_request += String("Host: ") + host + String("\r\n");
+    raw_request += String("Accept: text/event-stream\r\n");
+    raw_request += String("Cache-Control: no-cache\r\n\r\n");
+    return raw_request;
+}
+
+void Transport::start_events()
+{
+    this->events_buffer = String("");
+    this->events_http_code = 0;
+    this->events_last_read = millis();
+}
+
+bool Transport::next_event(String *data)
+{
+    // An event ends with a blank line
+    int event_end;
+    while ((event_end = this->events_buffer.indexOf("\n\n")) >= 0)
+    {
+        String event = this->events_buffer.substring(0, event_end + 1);
+        this->events_buffer.remove(0, event_end + 2);
+
+        // Join the data lines, the other fields and the comments (keep-alive) are ignored
+        bool has_data = false;
+        *data = String("");
+        int line_start = 0;
+        while (line_start < (int)event.length())
+        {
+            int line_end = event.indexOf('\n', line_start);
+            String line = event.substring(line_start, line_end);
+            line_start = line_end + 1;
+
+            if (!line.startsWith("data:"))
+                continue;
+            if (has_data)
+                *data += String("\n");
+            *data += line.substring((line.charAt(5) == ' ') ? 6 : 5);
+            has_data = true;
+        }
+
+        if (has_data)
+            return true;
+    }
+    return false;
+}
+
+// Http_response_parser
+// Private method(s)
+void Http_response_parser::parse_header_line()
+{
+    // Status line: HTTP/1.1 200 OK
+    if (this->http_code == 0)
+    {
+        int status_start = this->line.indexOf(' ');
+        this->http_code = (status_start < 0) ? -1 : this->line.substring(status_start + 1).toInt();
+        return;
+    }
+
+    int separator = this->line.indexOf(':');
+    if (separator < 0)
+        return;
+
+    String name = this->line.substring(0, separator);
+    String value = this->line.substring(separator + 1);
+    value.trim();
+    name.toLowerCase();
+
+    if (name == String("content-length"))
+        this->remaining = strtoul(value.c_str(), NULL, 10);
+    else if (name == String("etag"))
+        this->etag = value;
+    else if (name == String("content-type"))
+        this->content_type = value;
+    else
+    {
+        value.toLowerCase();
+        if (name == String("transfer-encoding") && value == String("chunked"))
+            this->chunked = true;
+        else if (name == String("connection") && value == String("close"))
+            this->keep_alive = false;
+    }
+}
+
+void Http_response_parser::end_headers()
+{
+    if (this->http_code == 304 || this->http_code == 204)
+        this->state = DONE;
+    else if (this->chunked)
+        this->state = CHUNK_SIZE;
+    else if (this->remaining != (unsigned long)-1)
+        this->state = (this->remaining == 0) ? DONE : BODY_LENGTH;
+    else
+    {
+        // No length given, the body end when the server close the connection
+        this->state = BODY_CLOSE;
+        this->keep_alive = false;
+    }
+}
+
+// Public method(s)
+void Http_response_parser::reset()
+{
+    this->state = HEADERS;
+    this->line = String("");
+    this->remaining = (unsigned long)-1;
+    this->chunked = false;
+    this->http_code = 0;
+    this->keep_alive = true;
+    this->etag = String("");
+    this->content_type = String("");
+    this->body = String("");
+}
+
+bool Http_response_parser::feed(const char *data, size_t length)
+{
+    size_t k = 0;
+    while (k < length && this->state != DONE)
+    {
+        // Body bytes are copied by block
+        if (this->state == BODY_LENGTH || this->state == CHUNK_DATA || this->state == BODY_CLOSE)
+        {
+            size_t size = length - k;
+            if (this->state != BODY_CLOSE && size > this->remaining)
+                size = this->remaining;
+
+            this->body.concat(data + k, size);
+            k += size;
+
+            if (this->state != BODY_CLOSE)
+            {
+                this->remaining -= size;
+                if (this->remaining == 0)
+                    this->state = (this->state == BODY_LENGTH) ? DONE : CHUNK_END;
+            }
+            continue;
+        }
+
+        // Other states are line based
+        char c = data[k++];
+        if (c != '\n')
+        {
+            if (c != '\r')
+                this->line.concat(c);
+            continue;
+        }
+
+        switch (this->state)
+        {
+        case HEADERS:
+            if (this->line.length() == 0)
+                this->end_headers();
+            else
+                this->parse_header_line();
+            break;
+
+        case CHUNK_SIZE:
+            this->remaining = strtoul(this->line.c_str(), NULL, 16);
+            this->state = (this->remaining == 0) ? CHUNK_TRAILER : CHUNK_DATA;
+            break;
+
+        case CHUNK_END:
+            this->state = CHUNK_SIZE;
+            break;
+
+        case CHUNK_TRAILER:
+            if (this->line.length() == 0)
+                this->state = DONE;
+            break;
+
+        default:
+            break;
+        }
+        this->line = String("");
+    }
+
+    return this->state == DONE;
+}
+
+bool Http_response_parser::finish()
+{
+    // Only a response without length can be ended by the connection close
+    if (this->state == BODY_CLOSE)
+        this->state = DONE;
+    return this->state == DONE;
+}
+
+#ifdef FLOKER_WIFI_ENABLED
+// Http_transport
+// Constructor
+Http_transport::Http_transport(bool keep_alive)
+{
+    this->keep_alive = keep_alive;
+    this->http_client.setReuse(keep_alive);
+
+    // Revision of the delta polling and encoding of the response
+    static const char *collected_headers[] = {"ETag", "Content-Type"};
+    this->http_client.collectHeaders(collected_headers, 2);
+}
+
+// Private method(s)
+int Http_transport::open_request(const char *uri, const String *request)
+{
+    this->http_client.begin(this->wifi_client, uri);
+    this->http_client.setTimeout(DEFAULT_HTTP_TIMEOUT + this->hold_time);
+    if (request != NULL)
+    {
+        this->http_client.addHeader("Content-Type", this->content_type);
+        this->http_client.addHeader("Accept", this->content_type);
+    }
+    if (this->if_none_match != String(""))
+        this->http_client.addHeader("If-None-Match", this->if_none_match);
+
+    return (request != NULL) ? this->http_client.POST(*request) : this->http_client.GET();
+}
+
+int Http_transport::send_request(const char *uri, const String *request)
+{
+    this->nb_bytes_sent += strlen(uri) + ((request != NULL) ? request->length() : 0);
+
+    // Count if the kept connection is still open (the server can close it)
+    bool reused = this->keep_alive && this->wifi_client.connected();
+    if (reused)
+        this->nb_reused_connections++;
+    else
+        this->nb_new_connections++;
+
+    int http_code = this->open_request(uri, request);
+
+    // The kept connection was closed by the server, retry once on a new one
+    if (http_code < 0 && reused)
+    {
+        this->close();
+        this->nb_new_connections++;
+        http_code = this->open_request(uri, request);
+    }
+
+    if (http_code < 0)
+        this->close();
+    else
+    {
+        this->etag = this->http_client.header("ETag");
+        this->response_content_type = this->http_client.header("Content-Type");
+    }
+
+    return http_code;
+}
+
+int Http_transport::read_response(int http_code, String *response)
+{
+    if (http_code >= 0 && http_code != 304)
+    {
+        *response = this->http_client.getString();
+        this->nb_bytes_received += response->length();
+    }
+
+    // With reuse enabled, end() keeps the connection open if the server allows it
+    this->http_client.end();
+    return http_code;
+}
+
+// Public method(s)
+int Http_transport::get(const char *uri, String *response)
+{
+    return this->read_response(this->send_request(uri, NULL), response);
+}
+
+int Http_transport::post(const char *uri, const String &request, String *response)
+{
+    return this->read_response(this->send_request(uri, &request), response);
+}
+
+int Http_transport::post_stream(const char *uri, const String &request, Stream **response_stream)
+{
+    int http_code = this->send_request(uri, &request);
+    if (http_code < 0)
+        return http_code;
+
+    // Nothing to read or a chunked response that can't be read directly from the socket, buffer it
+    if (http_code == 304)
+    {
+        this->stream_buffer = String("");
+        this->buffer_stream.set_string(&this->stream_buffer);
+        *response_stream = &this->buffer_stream;
+    }
+    else if (this->http_client.getSize() < 0)
+    {
+        this->stream_buffer = this->http_client.getString();
+        this->buffer_stream.set_string(&this->stream_buffer);
+        *response_stream = &this->buffer_stream;
+        this->nb_bytes_received += this->stream_buffer.length();
+    }
+    else
+    {
+        *response_stream = this->http_client.getStreamPtr();
+        this->nb_bytes_received += this->http_client.getSize();
+    }
+
+    return http_code;
+}
+
+int Http_transport::start_post(const char *uri, const String &request)
+{
+    String host, port, path;
+    Transport::split_uri(uri, &host, &port, &path);
+
+    // Reuse the kept connection, the TCP connect is the only blocking step
+    if (this->keep_alive && this->async_client.connected())
+        this->nb_reused_connections++;
+    else
+    {
+        this->async_client.stop();
+        this->nb_new_connections++;
+        if (!this->async_client.connect(host.c_str(), port.toInt()))
+            return HTTPC_ERROR_CONNECTION_FAILED;
+    }
+
+    String raw_request = this->make_raw_request("POST", host, path, &request, this->keep_alive);
+    this->nb_bytes_sent += raw_request.length();
+    if (this->async_client.write((const uint8_t *)raw_request.c_str(), raw_request.length()) != raw_request.length())
+    {
+        this->async_client.stop();
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+
+    this->parser.reset();
+    this->async_start = millis();
+    this->async_timeout = DEFAULT_ASYNC_TIMEOUT + this->hold_time;
+    return 0;
+}
+
+int Http_transport::poll_response(String *response)
+{
+    // Read a bounded amount of bytes on each call
+    uint8_t chunk[DEFAULT_ASYNC_READ_SIZE];
+    int available = this->async_client.available();
+    if (available > 0)
+    {
+        int nb_read = this->async_client.read(chunk, (available < (int)sizeof(chunk)) ? available : sizeof(chunk));
+        if (nb_read > 0)
+        {
+            this->nb_bytes_received += nb_read;
+            this->parser.feed((const char *)chunk, nb_read);
+        }
+    }
+
+    if (!this->parser.is_done())
+    {
+        if (!this->async_client.connected() && this->async_client.available() == 0)
+        {
+            // The server has closed the connection
+            if (!this->parser.finish())
+            {
+                this->async_client.stop();
+                return HTTPC_ERROR_CONNECTION_LOST;
+            }
+        }
+        else if (millis() - this->async_start > this->async_timeout)
+        {
+            this->async_client.stop();
+            return HTTPC_ERROR_READ_TIMEOUT;
+        }
+        else
+            return FLOKER_PENDING;
+    }
+
+    *response = this->parser.body;
+    this->parser.body = String("");
+    this->etag = this->parser.etag;
+    this->response_content_type = this->parser.content_type;
+
+    if (!this->parser.keep_alive || !this->keep_alive)
+        this->async_client.stop();
+
+    return this->parser.http_code;
+}
+
+void Http_transport::end_stream()
+{
+    Transport::end_stream();
+
+    // With reuse enabled, end() keeps the connection open if the server allows it
+    this->http_client.end();
+}
+
+void Http_transport::close()
+{
+    this->http_client.end();
+    this->wifi_client.stop();
+}
+
+bool Http_transport::open_events(const char *uri)
+{
+    String host, port, path;
+    Transport::split_uri(uri, &host, &port, &path);
+
+    this->events_client.stop();
+    if (!this->events_client.connect(host.c_str(), port.toInt()))
+        return false;
+
+    String raw_request = this->make_events_request(host, path);
+    if (this->events_client.write((const uint8_t *)raw_request.c_str(), raw_request.length()) != raw_request.length())
+    {
+        this->events_client.stop();
+        return false;
+    }
+
+    this->start_events();
+    return true;
+}
+
+int Http_transport::read_events(char *buffer, int size)
+{
+    int available = this->events_client.available();
+    if (available > 0)
+        return this->events_client.read((uint8_t *)buffer, (available < size) ? available : size);
+
+    return this->events_client.connected() ? 0 : -1;
+}
+
+void Http_transport::close_events()
+{
+    this->events_client.stop();
+}
+
+bool Http_transport::begin_poke(unsigned short port)
+{
+    return this->poke_udp.begin(port) == 1;
+}
+
+bool Http_transport::read_poke(String *hints)
+{
+    if (this->poke_udp.parsePacket() <= 0)
+        return false;
+
+    char datagram[DEFAULT_POKE_SIZE];
+    int size = this->poke_udp.read(datagram, sizeof(datagram) - 1);
+    datagram[(size > 0) ? size : 0] = '\0';
+    *hints = String(datagram);
+    return true;
+}
+#endif
+
+#ifdef HOST_ENABLED
+// Posix_transport
+// Destructor
+Posix_transport::~Posix_transport()
+{
+    this->close();
+    this->close_events();
+    if (this->poke_fd >= 0)
+        ::close(this->poke_fd);
+}
+
+int Posix_transport::connect_socket(String host, String port)
+{
+    struct addrinfo hints;
+    struct addrinfo *address = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &address) != 0)
+        return -1;
+
+    int socket_fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (socket_fd >= 0 && connect(socket_fd, address->ai_addr, address->ai_addrlen) != 0)
+    {
+        ::close(socket_fd);
+        socket_fd = -1;
+    }
+    freeaddrinfo(address);
+
+    return socket_fd;
+}
+
+bool Posix_transport::open_connection(String host, String port)
+{
+    this->socket_fd = Posix_transport::connect_socket(host, port);
+    if (this->socket_fd < 0)
+        return false;
+
+    this->host = host;
+    this->port = port;
+    this->nb_new_connections++;
+    return true;
+}
+
+int Posix_transport::read_response(String *response)
+{
+    this->parser.reset();
+
+    // A silent server fails the request instead of blocking, the long poll hold time is waited
+    unsigned long timeout = DEFAULT_HTTP_TIMEOUT + this->hold_time;
+    struct timeval receive_timeout;
+    receive_timeout.tv_sec = timeout / 1000;
+    receive_timeout.tv_usec = (timeout % 1000) * 1000;
+    setsockopt(this->socket_fd, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+
+    char chunk[512];
+    bool done = false;
+    while (!done)
+    {
+        ssize_t nb_read = recv(this->socket_fd, chunk, sizeof(chunk), 0);
+        if (nb_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return -4;
+        if (nb_read <= 0)
+        {
+            // The server has closed the connection
+            if (!this->parser.finish())
+                return -3;
+            break;
+        }
+        this->nb_bytes_received += nb_read;
+        done = this->parser.feed(chunk, nb_read);
+    }
+
+    *response = this->parser.body;
+    this->parser.body = String("");
+    this->etag = this->parser.etag;
+    this->response_content_type = this->parser.content_type;
+
+    if (!this->parser.keep_alive || !this->keep_alive)
+        this->close();
+
+    return this->parser.http_code;
+}
+
+int Posix_transport::send_request(String method, const char *uri, const String *request, String *response)
+{
+    String host, port, path;
+    Transport::split_uri(uri, &host, &port, &path);
+    String raw_request = this->make_raw_request(method, host, path, request, this->keep_alive);
+
+    // Reuse the opened connection if it points to the same server
+    if (this->socket_fd >= 0 && (this->host != host || this->port != port))
+        this->close();
+
+    bool reused = (this->socket_fd >= 0);
+    if (reused)
+        this->nb_reused_connections++;
+    else if (!this->open_connection(host, port))
+        return -1;
+
+    int http_code;
+    if (send(this->socket_fd, raw_request.c_str(), raw_request.length(), MSG_NOSIGNAL) != (ssize_t)raw_request.length())
+        http_code = -2;
+    else
+        http_code = this->read_response(response);
+
+    // The server may have closed the kept connection, retry once on a new one
+    if (http_code < 0 && reused)
+    {
+        this->close();
+        if (!this->open_connection(host, port))
+            return -1;
+
+        if (send(this->socket_fd, raw_request.c_str(), raw_request.length(), MSG_NOSIGNAL) != (ssize_t)raw_request.length())
+            http_code = -2;
+        else
+            http_code = this->read_response(response);
+    }
+
+    if (http_code < 0)
+        this->close();
+
+    return http_code;
+}
+
+void Posix_transport::close()
+{
+    if (this->socket_fd >= 0)
+        ::close(this->socket_fd);
+    this->socket_fd = -1;
+}
+
+int Posix_transport::get(const char *uri, String *response)
+{
+    return this->send_request("GET", uri, NULL, response);
+}
+
+int Posix_transport::post(const char *uri, const String &request, String *response)
+{
+    return this->send_request("POST", uri, &request, response);
+}
+
+bool Posix_transport::open_events(const char *uri)
+{
+    String host, port, path;
+    Transport::split_uri(uri, &host, &port, &path);
+
+    this->close_events();
+    this->events_fd = Posix_transport::connect_socket(host, port);
+    if (this->events_fd < 0)
+        return false;
+
+    String raw_request = this->make_events_request(host, path);
+    if (send(this->events_fd, raw_request.c_str(), raw_request.length(), MSG_NOSIGNAL) != (ssize_t)raw_request.length())
+    {
+        this->close_events();
+        return false;
+    }
+
+    this->start_events();
+    return true;
+}
+
+int Posix_transport::read_events(char *buffer, int size)
+{
+    ssize_t nb_read = recv(this->events_fd, buffer, size, MSG_DONTWAIT);
+    if (nb_read > 0)
+        return nb_read;
+
+    // Nothing received yet
+    if (nb_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return 0;
+    return -1;
+}
+
+void Posix_transport::close_events()
+{
+    if (this->events_fd >= 0)
+        ::close(this->events_fd);
+    this->events_fd = -1;
+}
+
+bool Posix_transport::begin_poke(unsigned short port)
+{
+    if (this->poke_fd >= 0)
+        ::close(this->poke_fd);
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    this->poke_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (this->poke_fd >= 0 && bind(this->poke_fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        ::close(this->poke_fd);
+        this->poke_fd = -1;
+    }
+
+    return this->poke_fd >= 0;
+}
+
+bool Posix_transport::read_poke(String *hints)
+{
+    if (this->poke_fd < 0)
+        return false;
+
+    char datagram[DEFAULT_POKE_SIZE];
+    ssize_t size = recv(this->poke_fd, datagram, sizeof(datagram) - 1, MSG_DONTWAIT);
+    if (size < 0)
+        return false;
+
+    datagram[size] = '\0';
+    *hints = String(datagram);
+    return true;
+}
+
+bool Posix_transport::send_poke(String host, unsigned short port, String hints)
+{
+    struct addrinfo hints_address;
+    struct addrinfo *address = NULL;
+    memset(&hints_address, 0, sizeof(hints_address));
+    hints_address.ai_family = AF_INET;
+    hints_address.ai_socktype = SOCK_DGRAM;
+
+    if (getaddrinfo(host.c_str(), String(port).c_str(), &hints_address, &address) != 0)
+        return false;
+
+    bool success = false;
+    int socket_fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (socket_fd >= 0)
+    {
+        success = sendto(socket_fd, hints.c_str(), hints.length(), 0, address->ai_addr, address->ai_addrlen) == (ssize_t)hints.length();
+        ::close(socket_fd);
+    }
+    freeaddrinfo(address);
+
+    return success;
+}
+
+String Posix_transport::error_to_string(int http_code)
+{
+    switch (http_code)
+    {
+    case -1:
+        return String("connection failed");
+    case -2:
+        return String("send failed");
+    case -3:
+        return String("invalid response");
+    case -4:
+        return String("read timeout");
+    default:
+        return String(http_code);
+    }
+}
+#endif
+
+// Mock_transport
+// Constructor
+Mock_transport::Mock_transport(String token)
+{
+    this->token = token;
+}
+
+// Destructor
+Mock_transport::~Mock_transport()
+{
+    delete[] this->topics;
+    delete[] this->subscriptions;
+    delete[] this->changes;
+}
+
+// Private method(s)
+int Mock_transport::find_topic(String topic)
+{
+    for (unsigned short k = 0; k < this->nb_topics; k++)
+        if (this->topics[k].topic == topic)
+            return k;
+    return -1;
+}
+
+String Mock_transport::get_parameter(const char *uri, String name)
+{
+    const char *query = strchr(uri, '?');
+    while (query != NULL)
+    {
+        const char *value = query + 1;
+        if (strncmp(value, name.c_str(), name.length()) == 0 && value[name.length()] == '=')
+        {
+            // Decode the percent-encoded value
+            String decoded;
+            for (value += name.length() + 1; *value != '\0' && *value != '&'; value++)
+            {
+                if (*value == '%' && isxdigit(value[1]) && isxdigit(value[2]))
+                {
+                    char hex[3] = {value[1], value[2], '\0'};
+                    decoded += (char)strtol(hex, NULL, 16);
+                    value += 2;
+                }
+                else
+                    decoded += (*value == '+') ? ' ' : *value;
+            }
+            return decoded;
+        }
+        query = strchr(value, '&');
+    }
+    return String("");
+}
+
+String Mock_transport::get_endpoint(String uri)
+{
+    int end = uri.indexOf('?');
+    if (end < 0)
+        end = uri.length();
+
+    int start = end;
+    while (start > 0 && uri.charAt(start - 1) != '/')
+        start--;
+
+    return uri.substring(start, end);
+}
+
+String Mock_transport::read_task(String topic, int *http_code)
+{
+    int index = this->find_topic(topic);
+    if (index < 0)
+    {
+        *http_code = 404;
+        return String("Topic not found");
+    }
+
+    *http_code = 200;
+    return this->topics[index].state;
+}
+
+String Mock_transport::write_task(String topic, String state, int *http_code)
+{
+    this->set_state(topic, state);
+    *http_code = 200;
+    return String("OK");
+}
+
+void Mock_transport::run_tasks(JsonArray tasks, JsonArray responses, bool keyed, unsigned long client_revision, unsigned short *index)
+{
+    for (JsonVariant task : tasks)
+    {
+        String type = task["type"].as<String>();
+        String topic = task["topic"].as<String>();
+        int http_code;
+
+        if (type == String("write"))
+        {
+            String data = this->write_task(topic, task["state"].as<String>(), &http_code);
+            if (!keyed)
+            {
+                JsonObject under_response = responses.createNestedObject();
+                under_response["data"] = data;
+                under_response["status"] = http_code;
+            }
+        }
+        else
+        {
+            // Only the topics changed since the client revision are sent in delta mode
+            int topic_index = this->find_topic(topic);
+            if (topic_index < 0 || this->topics[topic_index].revision > client_revision)
+            {
+                JsonObject under_response = responses.createNestedObject();
+                if (keyed)
+                    under_response["index"] = *index;
+                under_response["data"] = this->read_task(topic, &http_code);
+                under_response["status"] = http_code;
+            }
+        }
+        (*index)++;
+    }
+}
+
+int Mock_transport::multi_task(String request, String *response, bool delta, String subscription_id, unsigned long wait)
+{
+    // Subscription mode: the read tasks are the registered ones
+    String subscription_request = String("[]");
+    if (subscription_id != String(""))
+    {
+        unsigned short subscription_index = subscription_id.substring(1).toInt();
+        if (subscription_id.charAt(0) != 's' || subscription_index >= this->nb_subscriptions)
+        {
+            *response = String("Unknown subscription");
+            return 410;
+        }
+        subscription_request = this->subscriptions[subscription_index];
+    }
+
+    // MessagePack requests are compact, their expanded form is bigger
+    bool msgpack = this->content_type.startsWith(MSGPACK_CONTENT_TYPE);
+    DynamicJsonDocument json_subscription(subscription_request.length() * 2 + DEFAULT_UNDER_REQUEST_SIZE);
+    DynamicJsonDocument json_request(request.length() * (msgpack ? 8 : 2) + DEFAULT_UNDER_REQUEST_SIZE);
+    DeserializationError request_error;
+    if (msgpack)
+    {
+        DynamicJsonDocument json_compact_request(request.length() * 4 + DEFAULT_UNDER_REQUEST_SIZE);
+        request_error = deserializeMsgPack(json_compact_request, request.c_str(), request.length());
+        Json_tools::expand_tasks(json_compact_request.as<JsonArray>(), json_request.to<JsonArray>());
+    }
+    else
+        request_error = deserializeJson(json_request, request);
+
+    if (request_error || deserializeJson(json_subscription, subscription_request))
+    {
+        *response = String("Invalid request");
+        return 400;
+    }
+
+    JsonArray json_subscription_array = json_subscription.as<JsonArray>();
+    JsonArray json_task_array = json_request.as<JsonArray>();
+    DynamicJsonDocument json_response((json_subscription_array.size() + json_task_array.size() + 1) * DEFAULT_UNDER_RESPONSE_SIZE);
+    JsonArray json_response_array = json_response.to<JsonArray>();
+
+    // Delta mode: the client revision is given by the If-None-Match header
+    unsigned long client_revision = 0;
+    delta = delta && this->if_none_match != String("");
+    if (delta)
+        client_revision = strtoul(this->if_none_match.c_str() + (this->if_none_match.charAt(0) == '"' ? 1 : 0), NULL, 10);
+
+    // The responses are keyed by index in delta and subscription modes
+    bool keyed = delta || subscription_id != String("");
+    unsigned short index = 0;
+    // Long poll: wait for a change of the states sent by the client
+    if (wait > 0 && !this->hold(json_task_array, wait))
+    {
+        *response = String("");
+        return 304;
+    }
+
+    this->run_tasks(json_subscription_array, json_response_array, keyed, client_revision, &index);
+    this->run_tasks(json_task_array, json_response_array, keyed, client_revision, &index);
+
+    this->etag = String("\"") + String(this->revision) + String("\"");
+
+    // Nothing changed
+    *response = String("");
+    if (delta && json_response_array.size() == 0)
+        return 304;
+
+    // The response has the encoding of the request
+    if (msgpack)
+    {
+        DynamicJsonDocument json_compact_response(json_response.memoryUsage() + DEFAULT_UNDER_RESPONSE_SIZE);
+        Json_tools::compact_responses(json_response_array, json_compact_response.to<JsonArray>());
+        if (!Json_tools::to_msgpack(json_compact_response, response))
+            return 500;
+        this->response_content_type = String(MSGPACK_CONTENT_TYPE);
+    }
+    else
+        serializeJson(json_response, *response);
+    return 200;
+}
+
+int Mock_transport::subscribe_task(String request, String *response)
+{
+    // Grow the subscriptions store
+    if (this->nb_subscriptions == this->subscriptions_capacity)
+    {
+        unsigned short new_capacity = (this->subscriptions_capacity == 0) ? 4 : this->subscriptions_capacity * 2;
+        String *new_subscriptions = new String[new_capacity];
+        for (unsigned short k = 0; k < this->nb_subscriptions; k++)
+            new_subscriptions[k] = this->subscriptions[k];
+        delete[] this->subscriptions;
+        this->subscriptions = new_subscriptions;
+        this->subscriptions_capacity = new_capacity;
+    }
+
+    this->subscriptions[this->nb_subscriptions] = request;
+    *response = String("{\"id\":\"s") + String(this->nb_subscriptions) + String("\"}");
+    this->nb_subscriptions++;
+    return 200;
+}
+
+void Mock_transport::apply_changes()
+{
+    unsigned short nb_kept = 0;
+    for (unsigned short k = 0; k < this->nb_changes; k++)
+    {
+        if ((long)(millis() - this->changes[k].at) >= 0)
+            this->set_state(this->changes[k].topic, this->changes[k].state);
+        else
+            this->changes[nb_kept++] = this->changes[k];
+    }
+    this->nb_changes = nb_kept;
+}
+
+bool Mock_transport::has_changed(JsonArray tasks)
+{
+    for (JsonVariant task : tasks)
+    {
+        // A write or a read without known state is answered immediately
+        if (task["type"].as<String>() == String("write") || task["state"].isNull())
+            return true;
+
+        String state;
+        if (!this->get_state(task["topic"].as<String>(), &state) || state != task["state"].as<String>())
+            return true;
+    }
+    return false;
+}
+
+bool Mock_transport::hold(JsonArray tasks, unsigned long wait)
+{
+    unsigned long deadline = millis() + wait;
+    while (!this->has_changed(tasks))
+    {
+        // Sleep until the next scheduled change or the timeout
+        unsigned long wake_up = deadline;
+        for (unsigned short k = 0; k < this->nb_changes; k++)
+            if ((long)(this->changes[k].at - wake_up) < 0)
+                wake_up = this->changes[k].at;
+
+        if ((long)(wake_up - millis()) > 0)
+            delay(wake_up - millis());
+        this->apply_changes();
+
+        if (wake_up == deadline)
+            return this->has_changed(tasks);
+    }
+    return true;
+}
+
+// Public method(s)
+void Mock_transport::schedule_state(String topic, String state, unsigned long change_delay)
+{
+    // Grow the changes store
+    if (this->nb_changes == this->changes_capacity)
+    {
+        unsigned short new_capacity = (this->changes_capacity == 0) ? 4 : this->changes_capacity * 2;
+        Mock_change *new_changes = new Mock_change[new_capacity];
+        for (unsigned short k = 0; k < this->nb_changes; k++)
+            new_changes[k] = this->changes[k];
+        delete[] this->changes;
+        this->changes = new_changes;
+        this->changes_capacity = new_capacity;
+    }
+
+    this->changes[this->nb_changes].topic = topic;
+    this->changes[this->nb_changes].state = state;
+    this->changes[this->nb_changes].at = millis() + change_delay;
+    this->nb_changes++;
+}
+
+void Mock_transport::set_state(String topic, String state)
+{
+    int index = this->find_topic(topic);
+    if (index >= 0)
+    {
+        if (this->topics[index].state != state)
+        {
+            this->topics[index].state = state;
+            this->topics[index].revision = ++this->revision;
+        }
+        return;
+    }
+
+    // Grow the topics store
+    if (this->nb_topics == this->topics_capacity)
+    {
+        unsigned short new_capacity = (this->topics_capacity == 0) ? 8 : this->topics_capacity * 2;
+        Mock_topic *new_topics = new Mock_topic[new_capacity];
+        for (unsigned short k = 0; k < this->nb_topics; k++)
+            new_topics[k] = this->topics[k];
+        delete[] this->topics;
+        this->topics = new_topics;
+        this->topics_capacity = new_capacity;
+    }
+
+    this->topics[this->nb_topics].topic = topic;
+    this->topics[this->nb_topics].state = state;
+    this->topics[this->nb_topics].revision = ++this->revision;
+    this->nb_topics++;
+}
+
+bool Mock_transport::get_state(String topic, String *state)
+{
+    int index = this->find_topic(topic);
+    if (index < 0)
+        return false;
+
+    *state = this->topics[index].state;
+    return true;
+}
+
+int Mock_transport::get(const char *uri, String *response)
+{
+    this->nb_get_requests++;
+
+    // A simulated network failure sends nothing, a refused request is counted
+    if (this->failure_code != 0)
+        return this->failure_code;
+    this->nb_bytes_sent += strlen(uri);
+
+    this->apply_changes();
+
+    if (this->token != String("") && get_parameter(uri, "token") != this->token)
+    {
+        *response = String("Invalid token");
+        return 401;
+    }
+
+    String endpoint = get_endpoint(uri);
+    int http_code = 404;
+
+    if (endpoint == String("read"))
+        *response = this->read_task(get_parameter(uri, "topic"), &http_code);
+    else if (endpoint == String("write"))
+        *response = this->write_task(get_parameter(uri, "topic"), get_parameter(uri, "state"), &http_code);
+    else
+        *response = String("Unknown endpoint");
+
+    this->nb_bytes_received += response->length();
+    return http_code;
+}
+
+int Mock_transport::post(const char *uri, const String &request, String *response)
+{
+    this->nb_post_requests++;
+
+    // A simulated network failure sends nothing, a refused request is counted
+    if (this->failure_code != 0)
+        return this->failure_code;
+    this->nb_bytes_sent += strlen(uri) + request.length();
+
+    this->apply_changes();
+
+    if (this->token != String("") && get_parameter(uri, "token") != this->token)
+    {
+        *response = String("Invalid token");
+        return 401;
+    }
+
+    String endpoint = get_endpoint(uri);
+    this->response_content_type = String(JSON_CONTENT_TYPE);
+
+    if (endpoint == String("subscribe"))
+        return this->subscribe_task(request, response);
+
+    if (endpoint != String("multi"))
+    {
+        *response = String("Unknown endpoint");
+        return 404;
+    }
+
+    // Simulate a server without MessagePack support
+    if (!this->msgpack_supported && this->content_type.startsWith(MSGPACK_CONTENT_TYPE))
+    {
+        *response = String("Unsupported media type");
+        return 415;
+    }
+
+    int http_code = this->multi_task(
+        request, response,
+        get_parameter(uri, "delta") == String("true"),
+        get_parameter(uri, "subscription"),
+        strtoul(get_parameter(uri, "wait").c_str(), NULL, 10));
+    this->nb_bytes_received += response->length();
+    return http_code;
+}
+
+bool Mock_transport::open_events(const char *uri)
+{
+    if (this->failure_code != 0 || get_endpoint(uri) != String("events"))
+        return false;
+
+    if (this->token != String("") && get_parameter(uri, "token") != this->token)
+        return false;
+
+    String subscription_id = get_parameter(uri, "subscription");
+    unsigned short subscription_index = subscription_id.substring(1).toInt();
+    if (subscription_id.charAt(0) != 's' || subscription_index >= this->nb_subscriptions)
+        return false;
+
+    // Only the changes after the opening are streamed
+    this->apply_changes();
+    this->events_open = true;
+    this->events_subscription = subscription_index;
+    this->events_revision = this->revision;
+    this->events_ping = millis();
+    this->events_output = String("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n\r\n");
+
+    this->start_events();
+    return true;
+}
+
+int Mock_transport::read_events(char *buffer, int size)
+{
+    if (!this->events_open)
+        return -1;
+
+    // Stream the subscription topics changed since the last read
+    this->apply_changes();
+    if (this->revision != this->events_revision)
+    {
+        String subscription_request = this->subscriptions[this->events_subscription];
+        DynamicJsonDocument json_subscription(subscription_request.length() * 2 + DEFAULT_UNDER_REQUEST_SIZE);
+        deserializeJson(json_subscription, subscription_request);
+
+        for (JsonVariant task : json_subscription.as<JsonArray>())
+        {
+            int topic_index = this->find_topic(task["topic"].as<String>());
+            if (topic_index < 0 || this->topics[topic_index].revision <= this->events_revision)
+                continue;
+
+            DynamicJsonDocument json_event(DEFAULT_UNDER_RESPONSE_SIZE);
+            json_event["topic"] = this->topics[topic_index].topic;
+            json_event["state"] = this->topics[topic_index].state;
+
+            this->events_output += String("data: ");
+            serializeJson(json_event, this->events_output);
+            this->events_output += String("\n\n");
+        }
+        this->events_revision = this->revision;
+        this->events_ping = millis();
+    }
+
+    // Keep-alive comment
+    if (millis() - this->events_ping > DEFAULT_PUSH_TIMEOUT / 2)
+    {
+        this->events_output += String(": ping\n\n");
+        this->events_ping = millis();
+    }
+
+    int nb_read = ((int)this->events_output.length() < size) ? this->events_output.length() : size;
+    memcpy(buffer, this->events_output.c_str(), nb_read);
+    this->events_output.remove(0, nb_read);
+    return nb_read;
+}
+
+void Mock_transport::close_events()
+{
+    this->events_open = false;
+    this->events_output = String("");
+}
+
+void Mock_transport::send_poke(String hints)
+{
+    // Coalesce with the unread poke, an empty hint pokes all the topics
+    if (this->poked && (hints == String("") || this->poke_hints == String("")))
+        this->poke_hints = String("");
+    else if (this->poked)
+        this->poke_hints += String(",") + hints;
+    else
+        this->poke_hints = hints;
+    this->poked = true;
+}
+
+bool Mock_transport::read_poke(String *hints)
+{
+    if (!this->poked)
+        return false;
+
+    *hints = this->poke_hints;
+    this->poked = false;
+    this->poke_hints = String("");
+    return true;
+}
+#pragma endregion
+
+#pragma region Retry
+// Retry_policy
+// Constructor
+Retry_policy::Retry_policy(unsigned short max_attempts, unsigned long base_delay, unsigned long max_delay, unsigned long deadline)
+{
+    this->max_attempts = max_attempts;
+    this->base_delay = base_delay;
+    this->max_delay = max_delay;
+    this->deadline = deadline;
+}
+
+// Public method(s)
+unsigned long Retry_policy::get_delay(unsigned short attempt)
+{
+    // Exponential backoff capped to max_delay
+    unsigned long backoff = this->base_delay;
+    for (unsigned short k = 1; k < attempt && backoff < this->max_delay; k++)
+        backoff *= 2;
+    if (backoff > this->max_delay)
+        backoff = this->max_delay;
+
+    // Equal jitter: keep half of the backoff and randomize the other half
+    return backoff / 2 + random(backoff / 2 + 1);
+}
+
+// Circuit_breaker
+// Constructor
+Circuit_breaker::Circuit_breaker(unsigned short failure_threshold, unsigned long open_interval)
+{
+    this->failure_threshold = failure_threshold;
+    this->open_interval = open_interval;
+}
+
+// Public method(s)
+bool Circuit_breaker::allow_request()
+{
+    if (!this->open)
+        return true;
+
+    // Let a probe request go to check if the server is back
+    return millis() - this->opened_at >= this->open_interval;
+}
+
+void Circuit_breaker::on_success()
+{
+    this->nb_failures = 0;
+    this->open = false;
+}
+
+void Circuit_breaker::on_failure()
+{
+    if (this->nb_failures < this->failure_threshold)
+        this->nb_failures++;
+
+    // Open the breaker or re-open it after a failed probe
+    if (this->failure_threshold != 0 && this->nb_failures >= this->failure_threshold)
+    {
+        this->open = true;
+        this->opened_at = millis();
+    }
+}
+#pragma endregion
+
+#pragma region Metrics
+// Constructor
+Metrics::Metrics()
+{
+    for (unsigned short k = 0; k < NB_REQUEST_TYPES; k++)
+        this->nb_requests[k] = 0;
+    for (unsigned short k = 0; k < NB_LATENCY_BUCKETS; k++)
+        this->latency_histogram[k] = 0;
+}
+
+// Public method(s)
+void Metrics::record_request(Request_type type, bool success, unsigned long latency)
+{
+    this->nb_requests[type]++;
+    if (!success)
+        this->nb_failures++;
+
+    if (this->nb_latencies == 0 || latency < this->latency_min)
+        this->latency_min = latency;
+    if (latency > this->latency_max)
+        this->latency_max = latency;
+    this->latency_sum += latency;
+    this->nb_latencies++;
+
+    unsigned short bucket = 0;
+    for (unsigned long bound = DEFAULT_LATENCY_BUCKET_BASE; bucket < NB_LATENCY_BUCKETS - 1 && latency >= bound; bound *= 2)
+        bucket++;
+    this->latency_histogram[bucket]++;
+}
+
+void Metrics::record_heap(bool after_handle)
+{
+    unsigned long free_heap = Metrics::get_free_heap();
+    unsigned long largest_block = Metrics::get_largest_block();
+
+    if (after_handle)
+    {
+        this->free_heap_after = free_heap;
+        this->largest_block_after = largest_block;
+    }
+    else
+    {
+        this->free_heap_before = free_heap;
+        this->largest_block_before = largest_block;
+    }
+
+    if (this->min_free_heap == 0 || free_heap < this->min_free_heap)
+        this->min_free_heap = free_heap;
+}
+
+String Metrics::to_json()
+{
+    DynamicJsonDocument json_metrics(METRICS_JSON_SIZE);
+    String metrics;
+    this->to_json(json_metrics, &metrics);
+    return metrics;
+}
+
+bool Metrics::to_json(JsonDocument &json_metrics, String *metrics)
+{
+    json_metrics.clear();
+
+    JsonObject requests = json_metrics.createNestedObject("requests");
+    requests["read"] = this->nb_requests[READ_REQUEST];
+    requests["write"] = this->nb_requests[WRITE_REQUEST];
+    requests["multi"] = this->nb_requests[MULTI_REQUEST];
+    requests["subscribe"] = this->nb_requests[SUBSCRIBE_REQUEST];
+    requests["events"] = this->nb_requests[EVENTS_REQUEST];
+    json_metrics["failures"] = this->nb_failures;
+    json_metrics["retries"] = this->nb_retries;
+    json_metrics["sent"] = this->nb_bytes_sent;
+    json_metrics["received"] = this->nb_bytes_received;
+
+    JsonObject latency = json_metrics.createNestedObject("latency");
+    latency["min"] = this->latency_min;
+    latency["avg"] = this->get_latency_avg();
+    latency["max"] = this->latency_max;
+    JsonArray histogram = latency.createNestedArray("histogram");
+    for (unsigned short k = 0; k < NB_LATENCY_BUCKETS; k++)
+        histogram.add(this->latency_histogram[k]);
+
+    json_metrics["callbacks"] = this->nb_callbacks;
+
+    JsonObject filtered = json_metrics.createNestedObject("filtered");
+    filtered["callbacks"] = this->nb_filtered_callbacks;
+    filtered["writes"] = this->nb_filtered_writes;
+
+    JsonObject heap = json_metrics.createNestedObject("heap");
+    heap["before"] = this->free_heap_before;
+    heap["after"] = this->free_heap_after;
+    heap["largest_before"] = this->largest_block_before;
+    heap["largest_after"] = this->largest_block_after;
+    heap["min"] = this->min_free_heap;
+
+    if (json_metrics.overflowed())
+        return false;
+
+    *metrics = "";
+    serializeJson(json_metrics, *metrics);
+    return true;
+}
+
+unsigned long Metrics::get_free_heap()
+{
+#ifdef FLOKER_WIFI_ENABLED
+    return ESP.getFreeHeap();
+#else
+    return 0;
+#endif
+}
+
+unsigned long Metrics::get_largest_block()
+{
+#if defined(ESP8266_ENABLED)
+    return ESP.getMaxFreeBlockSize();
+#elif defined(ESP32_ENABLED)
+    return ESP.getMaxAllocHeap();
+#else
+    return 0;
+#endif
+}
+#pragma endregion
+
+// Server
+#pragma region Uri
+// Constructor
+Uri_builder::Uri_builder()
+{
+    this->buffer[0] = '\0';
+}
+
+// Private method(s)
+void Uri_builder::append_char(char c)
+{
+    // The last byte is kept for the terminating null
+    if (this->length + 1 >= DEFAULT_URI_SIZE)
+    {
+        this->overflow = true;
+        return;
+    }
+
+    this->buffer[this->length++] = c;
+    this->buffer[this->length] = '\0';
+}
+
+void Uri_builder::append_number(unsigned long number)
+{
+    char digits[11];
+    unsigned short nb_digits = 0;
+    do
+    {
+        digits[nb_digits++] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0);
+
+    while (nb_digits > 0)
+        this->append_char(digits[--nb_digits]);
+}
+
+// Public method(s)
+void Uri_builder::set_prefix(const char *scheme, const char *host, unsigned short port, const char *root_path)
+{
+    this->length = 0;
+    this->overflow = false;
+    this->buffer[0] = '\0';
+
+    this->append(scheme);
+    this->append(host);
+    this->append_char(':');
+    this->append_number(port);
+    this->append(root_path);
+
+    this->prefix_length = this->length;
+}
+
+void Uri_builder::start(const char *endpoint)
+{
+    // The prefix is already written, only its end is restored
+    this->length = this->prefix_length;
+    this->buffer[this->length] = '\0';
+    this->overflow = false;
+
+    this->append(endpoint);
+}
+
+void Uri_builder::add_parameter(const char *name, const char *value)
+{
+    this->append_char(strchr(this->buffer + this->prefix_length, '?') == NULL ? '?' : '&');
+    this->append(name);
+    this->append_char('=');
+    this->append_encoded(value);
+}
+
+void Uri_builder::add_parameter(const char *name, unsigned long value)
+{
+    this->add_parameter(name, "");
+    this->append_number(value);
+}
+
+void Uri_builder::append(const char *text)
+{
+    while (*text != '\0')
+        this->append_char(*text++);
+}
+
+void Uri_builder::append_encoded(const char *text)
+{
+    static const char hex_digits[] = "0123456789ABCDEF";
+    for (; *text != '\0'; text++)
+    {
+        if (is_unreserved(*text))
+            this->append_char(*text);
+        else
+        {
+            this->append_char('%');
+            this->append_char(hex_digits[(unsigned char)*text >> 4]);
+            this->append_char(hex_digits[(unsigned char)*text & 0x0F]);
+        }
+    }
+}
+
+bool Uri_builder::is_unreserved(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+           c == '-' || c == '_' || c == '.' || c == '~' || c == '/';
+}
+#pragma endregion
+
+#pragma region Server
+// Constructor
+Server_Manager::Server_Manager(
+    const char *ssid,
+    const char *password,
+    String request_type,
+    String server,
+    unsigned short port,
+    String root_path,
+    String token,
+    String device_path)
+{
+    this->ssid = ssid;
+    this->password = password;
+    this->request_type = request_type;
+    this->server = server;
+    this->port = port;
+    this->root_path = root_path;
+    this->token = token;
+    this->device_path = device_path;
+
+    // Default transport
+#ifdef FLOKER_WIFI_ENABLED
+    this->transport_ptr = new Http_transport();
+#endif
+#ifdef HOST_ENABLED
+    this->transport_ptr = new Posix_transport();
+#endif
+}
+
+// Destructor
+Server_Manager::~Server_Manager()
+{
+    if (this->own_transport)
+        delete this->transport_ptr;
+}
+
+// Private method(s)
+void Server_Manager::make_uri(const char *endpoint)
+{
+    // The constant prefix is only written once (and again if the port changes)
+    if (this->uri_port != this->port)
+    {
+        this->uri.set_prefix(this->request_type.c_str(), this->server.c_str(), this->port, this->root_path.c_str());
+        this->uri_port = this->port;
+    }
+
+    this->uri.start(endpoint);
+    this->uri.add_parameter("token", this->token.c_str());
+}
+
+bool Server_Manager::send_request(Metrics::Request_type type, const char *uri, const String *request, String *response, Stream **response_stream)
+{
+    // A truncated URI would target another topic or state, it will never be sent (URI Too Long)
+    if (this->uri.is_overflow())
+    {
+        FLOKER_LOG_ERROR("The URI is longer than DEFAULT_URI_SIZE, the request is skipped.");
+        this->last_http_code = 414;
+        return false;
+    }
+
+    // No network, don't issue a doomed request
+    if (this->connection_state != CONNECTED)
+    {
+        FLOKER_LOG_DEBUG("Not connected, the request is skipped.");
+        this->last_http_code = 0;
+        return false;
+    }
+
+    // The server is known to be down, don't wait for a doomed request
+    if (!this->circuit_breaker.allow_request())
+    {
+        FLOKER_LOG_WARNING("The circuit breaker is open, the request is skipped.");
+        this->last_http_code = 0;
+        return false;
+    }
+
+    // A single attempt: the forced writes are retried by Floker::handle(), without blocking
+    // Send the request and get the request response (or the stream to read it)
+    int http_code;
+    unsigned long request_start = millis();
+    if (response_stream != NULL)
+        http_code = this->transport_ptr->post_stream(uri, *request, response_stream);
+    else if (request != NULL)
+        http_code = this->transport_ptr->post(uri, *request, response);
+    else
+        http_code = this->transport_ptr->get(uri, response);
+
+    FLOKER_LOG_DEBUG("Response code: " + String(http_code));
+    if (http_code < 0)
+        FLOKER_LOG_WARNING("The request can't be sent: " + this->transport_ptr->error_to_string(http_code));
+    else if (response_stream != NULL)
+        FLOKER_LOG_DEBUG(http_code == 200 ? "The request was a success, the data will be streamed." : "The request was a failure !");
+    else if (http_code != 200)
+        FLOKER_LOG_DEBUG("The request was a failure !\nThe error response is :\n" + *response);
+    else
+        FLOKER_LOG_DEBUG("The request was a success, the data is: \n" + *response);
+
+    // 304: nothing has changed since the given revision
+    this->last_http_code = http_code;
+    bool success = (http_code == 200 || http_code == 304);
+
+    this->metrics.record_request(type, success, millis() - request_start);
+
+    // The failed response stream is not read
+    if (!success && response_stream != NULL)
+        this->transport_ptr->end_stream();
+
+    // Only unreachable or failing server count for the circuit breaker
+    if (success || (http_code >= 0 && http_code < 500))
+        this->circuit_breaker.on_success();
+    else
+        this->circuit_breaker.on_failure();
+
+    return success;
+}
+
+const String &Server_Manager::encode_multi_request(const String &request)
+{
+    this->transport_ptr->content_type = JSON_CONTENT_TYPE;
+    if (!this->enable_msgpack || !this->msgpack_supported)
+        return request;
+
+    // The same request (cached multi request body) is only encoded once
+    if (request != this->json_request_cache)
+    {
+        DynamicJsonDocument json_request(request.length() * 2 + DEFAULT_UNDER_REQUEST_SIZE);
+        if (deserializeJson(json_request, request))
+            return request;
+
+        DynamicJsonDocument json_compact_request(json_request.memoryUsage() + DEFAULT_UNDER_REQUEST_SIZE);
+        Json_tools::compact_tasks(json_request.as<JsonArray>(), json_compact_request.to<JsonArray>());
+        // Not enough memory to encode it: sent in JSON
+        if (!Json_tools::to_msgpack(json_compact_request, &this->msgpack_request_cache))
+        {
+            FLOKER_LOG_WARNING("The request can't be encoded in MessagePack, it is sent in JSON.");
+            this->json_request_cache = String("");
+            return request;
+        }
+        this->json_request_cache = request;
+    }
+
+    this->transport_ptr->content_type = MSGPACK_CONTENT_TYPE;
+    return this->msgpack_request_cache;
+}
+
+void Server_Manager::check_msgpack_support()
+{
+    // 415 Unsupported Media Type: fall back to JSON
+    if (this->enable_msgpack && this->msgpack_supported && this->last_http_code == 415)
+    {
+        FLOKER_LOG_WARNING("The server doesn't support MessagePack, the requests are sent in JSON.");
+        this->msgpack_supported = false;
+    }
+}
+
+bool Server_Manager::get_request(Metrics::Request_type type, const char *uri, String *response)
+{
+    FLOKER_LOG_DEBUG(String("Open get request:\nuri: ") + uri);
+
+    return this->send_request(type, uri, NULL, response);
+}
+
+bool Server_Manager::post_request(Metrics::Request_type type, const char *uri, const String &request, String *response)
+{
+    FLOKER_LOG_DEBUG(String("Open post request:\nuri: ") + uri);
+
+    return this->send_request(type, uri, &request, response);
+}
+
+// Public method(s)
+void Server_Manager::set_transport(Transport *transport_ptr)
+{
+    if (this->own_transport)
+        delete this->transport_ptr;
+
+    this->transport_ptr = transport_ptr;
+    this->own_transport = false;
+}
+
+void Server_Manager::begin()
+{
+#ifdef FLOKER_WIFI_ENABLED
+    // The transport can work without WiFi (mock server)
+    if (!this->transport_ptr->need_wifi())
+    {
+        this->ip = WiFi.localIP().toString();
+        this->connection_state = CONNECTED;
+        this->nb_connections++;
+        return;
+    }
+
+    // Start the WiFi connection, it is established by handle_connection()
+    this->start_wifi();
+#endif
+#ifdef HOST_ENABLED
+    this->ip = FLOKER_HOST_IP;
+    this->connection_state = CONNECTED;
+    this->nb_connections++;
+#endif
+}
+
+#ifdef FLOKER_WIFI_ENABLED
+void Server_Manager::start_wifi()
+{
+    FLOKER_LOG_INFO("Try to connect to " + String(this->ssid));
+
+    WiFi.begin(this->ssid, this->password);
+    this->connection_state = CONNECTING;
+    this->connection_state_time = millis();
+}
+#endif
+
+bool Server_Manager::handle_connection()
+{
+#ifdef FLOKER_WIFI_ENABLED
+    if (!this->transport_ptr->need_wifi())
+        return this->connection_state == CONNECTED;
+
+    switch (this->connection_state)
+    {
+    case CONNECTING:
+        if (WiFi.status() == WL_CONNECTED)
+        {
+            this->ip = WiFi.localIP().toString();
+            this->connection_state = CONNECTED;
+            this->nb_connections++;
+
+            FLOKER_LOG_INFO("Connection is established ! Your ip is: " + this->ip);
+        }
+        // Give up this try and wait before the next one
+        else if (millis() - this->connection_state_time > DEFAULT_WIFI_CONNECT_TIMEOUT)
+        {
+            FLOKER_LOG_WARNING("The WiFi connection has timed out.");
+
+            WiFi.disconnect();
+            this->connection_state = DISCONNECTED;
+            this->connection_state_time = millis();
+        }
+        break;
+
+    case CONNECTED:
+        if (WiFi.status() != WL_CONNECTED)
+        {
+            FLOKER_LOG_WARNING("The WiFi connection is lost, let's reconnect.");
+
+            // The kept server connections are dead
+            this->transport_ptr->close();
+            this->transport_ptr->close_events();
+            this->start_wifi();
+        }
+        break;
+
+    case DISCONNECTED:
+        if (millis() - this->connection_state_time > DEFAULT_WIFI_RETRY_INTERVAL)
+            this->start_wifi();
+        break;
+    }
+#endif
+
+    return this->connection_state == CONNECTED;
+}
+
+bool Server_Manager::read(const String &topic_path, String *get_data)
+{
+    this->make_uri("read");
+    this->uri.add_parameter("topic", topic_path.c_str());
+    this->uri.add_parameter("parse", "state");
+    return get_request(Metrics::READ_REQUEST, this->uri.c_str(), get_data);
+}
+
+bool Server_Manager::write(const String &topic_path, const String &data_to_write)
+{
+    this->make_uri("write");
+    this->uri.add_parameter("topic", topic_path.c_str());
+    this->uri.add_parameter("state", data_to_write.c_str());
+    if (this->uri.is_overflow())
+        return this->write_in_body(topic_path, data_to_write);
+
+    String response;
+    return get_request(Metrics::WRITE_REQUEST, this->uri.c_str(), &response);
+}
+
+bool Server_Manager::write_in_body(const String &topic_path, const String &data_to_write)
+{
+    FLOKER_LOG_DEBUG("The state of " + topic_path + " is too large for the URI, it is sent in a multi request.");
+
+    DynamicJsonDocument json_request(JSON_ARRAY_SIZE(1) + JSON_OBJECT_SIZE(3) + topic_path.length() + data_to_write.length() + 2);
+    Json_tools::add_write_task(json_request.to<JsonArray>(), topic_path, data_to_write);
+    String request;
+    serializeJson(json_request, request);
+
+    String response;
+    return this->multi_tasks(request, &response);
+}
+
+bool Server_Manager::multi_tasks(String request, String *response)
+{
+    this->make_uri("multi");
+    this->uri.add_parameter("parse", "response");
+    bool success = post_request(Metrics::MULTI_REQUEST, this->uri.c_str(), this->encode_multi_request(request), response);
+    this->transport_ptr->content_type = JSON_CONTENT_TYPE;
+    this->check_msgpack_support();
+    return success;
+}
+
+bool Server_Manager::subscribe(String request, String *response)
+{
+    this->make_uri("subscribe");
+    return this->post_request(Metrics::SUBSCRIBE_REQUEST, this->uri.c_str(), request, response);
+}
+
+const char *Server_Manager::prepare_multi_request(const String *revision, const String *subscription_id, unsigned long hold_time)
+{
+    this->make_uri("multi");
+    this->uri.add_parameter("parse", "response");
+
+    // Subscription mode: the registered read tasks are executed by the server
+    if (subscription_id != NULL && subscription_id->length() > 0)
+        this->uri.add_parameter("subscription", subscription_id->c_str());
+
+    // Delta mode: only the changed topics since the revision are returned
+    if (revision != NULL)
+        this->uri.add_parameter("delta", "true");
+    if (revision != NULL)
+        this->transport_ptr->if_none_match = *revision;
+    else
+        this->transport_ptr->if_none_match = "";
+
+    // Long poll: the server can hold the request until a state changes
+    if (hold_time > 0)
+        this->uri.add_parameter("wait", hold_time);
+    this->transport_ptr->hold_time = hold_time;
+
+    return this->uri.c_str();
+}
+
+bool Server_Manager::multi_tasks_stream(const String &request, Stream **response_stream, const String *revision, const String *subscription_id, unsigned long hold_time)
+{
+    const char *uri = this->prepare_multi_request(revision, subscription_id, hold_time);
+
+    FLOKER_LOG_DEBUG(String("Open streamed post request:\nuri: ") + uri);
+
+    bool success = this->send_request(Metrics::MULTI_REQUEST, uri, &this->encode_multi_request(request), NULL, response_stream);
+    this->transport_ptr->if_none_match = "";
+    this->transport_ptr->hold_time = 0;
+    this->transport_ptr->content_type = JSON_CONTENT_TYPE;
+    this->check_msgpack_support();
+
+    return success;
+}
+
+bool Server_Manager::start_multi_tasks(const String &request, const String *revision, const String *subscription_id, unsigned long hold_time)
+{
+    if (this->connection_state != CONNECTED || !this->circuit_breaker.allow_request())
+        return false;
+
+    const char *uri = this->prepare_multi_request(revision, subscription_id, hold_time);
+    if (this->uri.is_overflow())
+    {
+        FLOKER_LOG_ERROR("The URI is longer than DEFAULT_URI_SIZE, the request is skipped.");
+        this->last_http_code = 414;
+        this->transport_ptr->if_none_match = String("");
+        this->transport_ptr->hold_time = 0;
+        return false;
+    }
+
+    FLOKER_LOG_DEBUG(String("Start asynchronous post request:\nuri: ") + uri);
+
+    this->async_request_start = millis();
+    int http_code = this->transport_ptr->start_post(uri, this->encode_multi_request(request));
+    // The request options are not kept for the direct requests sent while it is in flight
+    this->transport_ptr->if_none_match = String("");
+    this->transport_ptr->content_type = JSON_CONTENT_TYPE;
+    this->transport_ptr->hold_time = 0;
+
+    if (http_code < 0)
+    {
+        FLOKER_LOG_WARNING("The request can't be sent: " + this->transport_ptr->error_to_string(http_code));
+
+        this->last_http_code = http_code;
+        this->metrics.record_request(Metrics::MULTI_REQUEST, false, millis() - this->async_request_start);
+        this->circuit_breaker.on_failure();
+        return false;
+    }
+
+    return true;
+}
+
+int Server_Manager::poll_multi_tasks(String *response)
+{
+    int http_code = this->transport_ptr->poll_response(response);
+    if (http_code == FLOKER_PENDING)
+        return http_code;
+
+    FLOKER_LOG_DEBUG("Asynchronous response code: " + String(http_code));
+
+    this->last_http_code = http_code;
+    this->check_msgpack_support();
+    this->metrics.record_request(Metrics::MULTI_REQUEST, http_code == 200 || http_code == 304, millis() - this->async_request_start);
+    if (http_code >= 0 && http_code < 500)
+        this->circuit_breaker.on_success();
+    else
+        this->circuit_breaker.on_failure();
+
+    return http_code;
+}
+
+void Server_Manager::end_stream()
+{
+    this->transport_ptr->end_stream();
+}
+
+bool Server_Manager::open_events(String subscription_id)
+{
+    if (this->connection_state != CONNECTED || !this->circuit_breaker.allow_request())
+        return false;
+
+    this->make_uri("events");
+    this->uri.add_parameter("subscription", subscription_id.c_str());
+    if (this->uri.is_overflow())
+        return false;
+
+    FLOKER_LOG_DEBUG(String("Open the event stream:\nuri: ") + this->uri.c_str());
+
+    unsigned long request_start = millis();
+    bool success = this->transport_ptr->open_events(this->uri.c_str());
+    this->metrics.record_request(Metrics::EVENTS_REQUEST, success, millis() - request_start);
+    return success;
+}
+
+Metrics *Server_Manager::get_metrics()
+{
+    this->metrics.nb_bytes_sent = this->transport_ptr->nb_bytes_sent;
+    this->metrics.nb_bytes_received = this->transport_ptr->nb_bytes_received;
+    return &this->metrics;
+}
+
+#pragma endregion
+
+// Software_polling
+#pragma region Software_polling
+// Constructor
+Software_polling::Software_polling(
+    String connection_state_topic_path,
+    String connection_interval_topic_path,
+    String connection_type_topic_path,
+    String connection_version_topic_path,
+    String connection_ip_topic_path)
+{
+    this->connection_state_topic_path = connection_state_topic_path;
+    this->connection_interval_topic_path = connection_interval_topic_path;
+    this->connection_type_topic_path = connection_type_topic_path;
+    this->connection_version_topic_path = connection_version_topic_path;
+    this->connection_ip_topic_path = connection_ip_topic_path;
+}
+// Public: Begin and Handle functions
+void Software_polling::handle(Server_Manager *server_ptr, Write_queue *write_queue, JsonDocument *json_arena)
+{
+    // The requests are queued and sent with the next channels request (no extra round trip)
+    // The static information are pushed again after a reconnection (the ip may have changed)
+    bool static_information_pushed = (this->static_information_connection == server_ptr->nb_connections);
+
+    if (millis() - this->last_connection_update > global_connection_update_interval || !static_information_pushed)
+    {
+        this->last_connection_update = millis();
+        write_queue->push(this->connection_state_topic_path, "connected");
+
+        // The refresh interval is read by the interval channel
+        if (!static_information_pushed)
+        {
+            // Send static device informations in the same batch
+            write_queue->push(this->connection_type_topic_path, server_ptr->device_type);
+            write_queue->push(this->connection_version_topic_path, FLOLIB_FLOKER_VERSION);
+            write_queue->push(this->connection_ip_topic_path, server_ptr->ip);
+            this->static_information_connection = server_ptr->nb_connections;
+        }
+    }
+
+    // The metrics are one write of their JSON
+    if (this->metrics_interval != 0 && millis() - this->last_metrics_update >= this->metrics_interval)
+    {
+        this->last_metrics_update = millis();
+
+        // The arena is cleared before the channels request is built in it
+        String metrics;
+        if (server_ptr->get_metrics()->to_json(*json_arena, &metrics))
+            write_queue->push(this->metrics_topic_path, metrics);
+        else
+            FLOKER_LOG_ERROR("The JSON arena is too small for the metrics, they are not published.");
+    }
+}
+
+void Software_polling::set_metrics_publishing(String metrics_topic_path, unsigned long interval)
+{
+    this->metrics_topic_path = metrics_topic_path;
+    this->metrics_interval = interval;
+    this->last_metrics_update = millis();
+}
+
+void Software_polling::subscribe_interval_channel(Channel_registry *channels)
+{
+    channels->add(
+        this->connection_interval_topic_path,
+        this->update_polling_interval,
+        String(global_connection_update_interval));
+}
+#pragma endregion
+
+#pragma region Floker
+// Constructor
+Floker::Floker(
+    const char *ssid,
+    const char *password,
+    bool secure_connection,
+    String server,
+    String root_path,
+    String token,
+    String device_path)
+{
+    this->server_ptr = new Server_Manager(
+        ssid, password,
+        secure_connection ? String(HTTPS_REQUEST) : String(HTTP_REQUEST),
+        server,
+        secure_connection ? HTTPS_PORT : HTTP_PORT,
+        root_path,
+        token,
+        device_path);
+}
+
+// Destructor
+Floker::~Floker()
+{
+    delete this->software_polling_ptr;
+    delete this->server_ptr;
+    free(this->batch_indexes);
+#ifndef FLOKER_STATIC_MEMORY
+    delete this->json_arena_document;
+#endif
+}
+
+// Private method(s)
+String Floker::get_path(String path, bool autocomplete)
+{
+    // Patern device path is set
+    if (autocomplete && this->server_ptr->device_path != String(""))
+        path = DEFAULT_START_IOT_PATH + this->server_ptr->device_path + path;
+    return path;
+}
+
+Channel *Floker::add_channel(String topic_path, bool autocomplete_topic, unsigned long poll_period)
+{
+    topic_path = this->get_path(topic_path, autocomplete_topic);
+
+#ifdef FLOKER_STATIC_MEMORY
+    if (topic_path.length() >= FLOKER_TOPIC_SIZE)
+    {
+        FLOKER_LOG_ERROR("The topic " + topic_path + " is longer than FLOKER_TOPIC_SIZE, it is not subscribed.");
+        return NULL;
+    }
+#endif
+
+    Channel *channel = this->channels.add(topic_path, NULL);
+    if (channel == NULL)
+    {
+#ifdef FLOKER_STATIC_MEMORY
+        FLOKER_LOG_ERROR("FLOKER_MAX_CHANNELS channels are already subscribed, " + topic_path + " is not subscribed.");
+#else
+        FLOKER_LOG_ERROR("Not enough memory, " + topic_path + " is not subscribed.");
+#endif
+        return NULL;
+    }
+
+    // Only the callback of the last subscribe is kept
+    channel->function = NULL;
+    channel->text_function = NULL;
+    channel->view_function = NULL;
+    channel->type = Channel::TEXT_VALUE;
+    channel->value.integer = 0;
+    channel->has_value = false;
+    channel->enum_names = NULL;
+    channel->nb_enum_names = 0;
+    channel->typed_call = NULL;
+
+    // Nor its filters (set again by set_read_filter)
+    channel->deadband = 0;
+    channel->hysteresis = 0;
+    channel->min_interval = 0;
+    channel->last_direction = 0;
+    channel->held = false;
+
+    // The channel is due now and then every poll_period
+    channel->poll_period = poll_period;
+    channel->next_poll = millis();
+    this->scheduler.invalidate();
+    return channel;
+}
+
+void Floker::reserve_buffers()
+{
+    // The scheduler and the batch don't grow while the channels don't change
+    this->scheduler.reserve(this->channels.size());
+    if (this->batch_capacity < this->channels.size())
+    {
+        free(this->batch_indexes);
+        this->batch_capacity = this->channels.size();
+        this->batch_indexes = (unsigned short *)malloc(this->batch_capacity * sizeof(unsigned short));
+    }
+
+#ifdef FLOKER_STATIC_MEMORY
+    this->multi_request_body.reserve(FLOKER_REQUEST_SIZE);
+    this->multi_request.reserve(FLOKER_REQUEST_SIZE);
+    this->write_tasks.reserve(FLOKER_REQUEST_SIZE);
+    this->response.reserve(FLOKER_STATE_SIZE);
+    this->response_text.reserve(FLOKER_STATE_SIZE);
+    this->previous_state.reserve(FLOKER_STATE_SIZE);
+    this->write_queue.reserve(FLOKER_MAX_WRITES);
+    this->in_flight_writes.reserve(FLOKER_MAX_WRITES);
+    this->retry_queue.reserve(FLOKER_MAX_WRITES);
+#endif
+
+    this->reset_json_arena();
+}
+
+void Floker::update_channel(Channel *channel, const char *state)
+{
+    FLOKER_LOG_DEBUG(String("State ------> ") + state + "\nOld state --> " + channel->state);
+
+    // Check if the state have changed
+    if (channel->state != state)
+    {
+#ifdef FLOKER_STATIC_MEMORY
+        // The state buffer is not reallocated
+        if (strlen(state) >= FLOKER_STATE_SIZE)
+        {
+            FLOKER_LOG_ERROR("The state of " + channel->topic_path + " is longer than FLOKER_STATE_SIZE, it is ignored.");
+            return;
+        }
+#endif
+
+        if (channel->type != Channel::TEXT_VALUE)
+        {
+            this->update_typed_channel(channel, state);
+            return;
+        }
+
+        FLOKER_LOG_DEBUG("The state have changed, let's execute the callback function !");
+
+        // The old state is kept aside (the buffers are exchanged, not copied) and the channel
+        // is not used after the callback, it can subscribe or unsubscribe
+        std::swap(this->previous_state, channel->state);
+        channel->state = state;
+        this->server_ptr->metrics.nb_callbacks++;
+
+        if (channel->view_function != NULL)
+        {
+            State_view new_state = {state, strlen(state)};
+            State_view old_state = {this->previous_state.c_str(), this->previous_state.length()};
+            channel->view_function(channel->context, *channel, new_state, old_state);
+        }
+        else if (channel->text_function != NULL)
+            channel->text_function(state);
+        else
+            channel->function(state);
+    }
+    else
+        FLOKER_LOG_DEBUG("The state have not changed.");
+}
+
+void Floker::update_typed_channel(Channel *channel, const char *state)
+{
+    // The text is kept for the watch requests, even when the value is the same ("21.50" and "21.5")
+    bool text_changed = (channel->state != state);
+    if (text_changed)
+        channel->state = state;
+
+    Channel_value value;
+    if (!channel->parse_value(state, &value))
+    {
+        FLOKER_LOG_WARNING(String("The state ") + state + " of " + channel->topic_path + " is not a valid value, it is ignored.");
+        return;
+    }
+
+    if (!channel->accept_value(value))
+    {
+        // Only the deadband and the hysteresis drop a change, min_interval holds it back
+        if (text_changed && !channel->held && !channel->is_same_value(value))
+            this->server_ptr->metrics.nb_filtered_callbacks++;
+        FLOKER_LOG_DEBUG("The value have not changed (or is filtered).");
+
+        // Released by handle(), even if the server doesn't send the state again
+        unsigned long release = channel->last_notify + channel->min_interval;
+        if (channel->held && (!this->held_pending || (long)(release - this->held_release) < 0))
+        {
+            this->held_pending = true;
+            this->held_release = release;
+        }
+        return;
+    }
+
+    FLOKER_LOG_DEBUG("The value have changed, let's execute the callback function !");
+
+    // The channel is not used after the callback, it can subscribe or unsubscribe
+    this->server_ptr->metrics.nb_callbacks++;
+    channel->typed_call(channel->typed_function, value);
+}
+
+void Floker::release_held_channels()
+{
+    if (!this->held_pending || (long)(millis() - this->held_release) < 0)
+        return;
+
+    // Rescheduled by the channels still held back
+    this->held_pending = false;
+    unsigned long version = this->channels.version;
+    for (unsigned short k = 0; k < this->channels.size() && version == this->channels.version; k++)
+    {
+        Channel *channel = &this->channels[k];
+        if (channel->held)
+            this->update_typed_channel(channel, channel->state.c_str());
+    }
+
+    // A callback has subscribed or unsubscribed, the remaining channels are checked on the next handle
+    if (version != this->channels.version)
+    {
+        this->held_pending = true;
+        this->held_release = millis();
+    }
+}
+
+unsigned short Floker::schedule_batch()
+{
+    if (this->batch_capacity < this->channels.size())
+    {
+        free(this->batch_indexes);
+        this->batch_capacity = this->channels.size();
+        this->batch_indexes = (unsigned short *)malloc(this->batch_capacity * sizeof(unsigned short));
+    }
+
+    // Only the due channels are polled
+    this->scheduler.update(&this->channels);
+    this->batch_size = this->writes_only ? 0 : this->scheduler.pop_due(&this->channels, millis(), this->batch_indexes);
+    this->batch_version = this->channels.version;
+    this->batch_full = (this->batch_size == this->channels.size());
+
+    return this->batch_size;
+}
+
+void Floker::classic_subscribed_channels_handle()
+{
+    this->schedule_batch();
+    for (unsigned short k = 0; k < this->batch_size && this->batch_version == this->channels.version; k++)
+    {
+        Channel *channel = &this->channels[this->batch_indexes[k]];
+        FLOKER_LOG_DEBUG("\nTopic path: " + channel->topic_path);
+
+        if (this->server_ptr->read(channel->topic_path, &this->response))
+            this->update_channel(channel, this->response.c_str());
+        else
+        {
+            // Polled again on the next cycle
+            channel->next_poll = millis();
+            this->scheduler.invalidate();
+        }
+    }
+}
+
+void Floker::retry_batch()
+{
+    // The indexes are only valid for the same channels
+    if (this->batch_size == 0 || this->batch_version != this->channels.version)
+        return;
+
+    unsigned long now = millis();
+    for (unsigned short k = 0; k < this->batch_size; k++)
+        this->batch_channel(k)->next_poll = now;
+    this->scheduler.invalidate();
+}
+
+#ifndef FLOKER_STATIC_MEMORY
+size_t Floker::get_json_arena_size()
+{
+    // Request: a task per channel (with its state in long poll) and per buffered write, the Strings are copied
+    size_t request_size = JSON_ARRAY_SIZE(this->channels.size() + this->write_queue.size());
+    size_t largest_topic = 0;
+    size_t largest_state = 0;
+    for (unsigned short k = 0; k < this->channels.size(); k++)
+    {
+        Channel *channel = &this->channels[k];
+        request_size += JSON_OBJECT_SIZE(4) + channel->topic_path.length() + channel->state.length() + 2;
+        if (channel->topic_path.length() > largest_topic)
+            largest_topic = channel->topic_path.length();
+        if (channel->state.length() > largest_state)
+            largest_state = channel->state.length();
+    }
+    for (unsigned short k = 0; k < this->write_queue.size(); k++)
+        request_size += JSON_OBJECT_SIZE(3) + this->write_queue[k].topic_path.length() + this->write_queue[k].state.length() + 2;
+
+    // Response: the under responses and the events are parsed one at a time
+    size_t response_size = JSON_OBJECT_SIZE(3) + largest_topic + largest_state + DEFAULT_JSON_ARENA_MARGIN;
+
+    size_t size = (request_size > response_size) ? request_size : response_size;
+
+    // The published metrics are built in the arena too
+    if (this->enable_software_polling && this->software_polling_ptr->is_publishing_metrics() && size < METRICS_JSON_SIZE)
+        size = METRICS_JSON_SIZE;
+
+    // The last request or response didn't fit in the arena: double it
+    if (this->json_arena_overflow && this->json_arena != NULL && size < this->json_arena->capacity() * 2)
+        size = this->json_arena->capacity() * 2;
+    this->json_arena_overflow = false;
+
+    return size;
+}
+
+#endif
+
+void Floker::reset_json_arena()
+{
+#ifdef FLOKER_STATIC_MEMORY
+    // Fixed size: the requests and the responses which don't fit are skipped
+    this->json_arena = &this->json_arena_document;
+    this->json_arena_overflow = false;
+#else
+    size_t size = this->get_json_arena_size();
+    if (this->json_arena_document == NULL || this->json_arena_document->capacity() < size)
+    {
+        // Grown with a margin, the arena is not allocated again while the channels only change a little
+        delete this->json_arena_document;
+        this->json_arena_document = new DynamicJsonDocument(size + size / 4);
+        this->json_arena = this->json_arena_document;
+
+        FLOKER_LOG_DEBUG("JSON arena size: " + String(this->json_arena->capacity()));
+    }
+#endif
+
+    this->json_arena->clear();
+}
+
+bool Floker::check_json_arena()
+{
+    if (!this->json_arena->overflowed())
+        return true;
+
+    FLOKER_LOG_ERROR("The JSON arena is too small.");
+    this->json_arena_overflow = true;
+    return false;
+}
+
+void Floker::build_multi_request_body()
+{
+    // The subscription set has not changed since the last build
+    if (this->multi_request_version == this->channels.version && this->multi_request_body != String(""))
+        return;
+
+    FLOKER_LOG_DEBUG("\nThe subscribed channels have changed, rebuild the multi request body.");
+
+    // Create Json request, all request here are "read" request
+    JsonArray json_under_request_array = this->json_arena->to<JsonArray>();
+
+    for (unsigned short k = 0; k < this->channels.size(); k++)
+        Json_tools::add_read_task(json_under_request_array, this->channels[k].topic_path);
+
+    // An incomplete body is not kept
+    if (!this->check_json_arena())
+        return;
+
+    this->multi_request_body = String("");
+    serializeJson(*this->json_arena, this->multi_request_body);
+    this->multi_request_version = this->channels.version;
+
+    // The indexes have changed, the next delta poll must get all the states
+    this->reset_revision();
+}
+
+bool Floker::register_subscription()
+{
+    if (!this->subscription_supported)
+        return false;
+
+    // Already registered with the current channels
+    if (this->subscription_id != String("") && this->subscription_version == this->multi_request_version)
+        return true;
+
+    FLOKER_LOG_INFO("\nRegister the subscribed channels on the server.");
+
+    this->subscription_id = String("");
+    String response;
+    if (!this->server_ptr->subscribe(this->multi_request_body, &response))
+    {
+        // The server doesn't support the subscriptions, fall back to the full requests
+        if (this->server_ptr->last_http_code == 404)
+            this->subscription_supported = false;
+        return false;
+    }
+
+    StaticJsonDocument<DEFAULT_SUBSCRIPTION_RESPONSE_SIZE> json_response;
+    if (deserializeJson(json_response, response))
+        return false;
+
+    this->subscription_id = json_response["id"] | "";
+    this->subscription_version = this->multi_request_version;
+
+    // The server gives keyed responses from now, get all the states again
+    this->reset_revision();
+
+    return this->subscription_id != String("");
+}
+
+void Floker::append_write_tasks(String *request)
+{
+    if (this->write_queue.size() == 0)
+        return;
+
+    FLOKER_LOG_DEBUG("\nFlush " + String(this->write_queue.size()) + " buffered write(s) in the multi request.");
+
+    this->write_queue.add_tasks(this->json_arena->to<JsonArray>());
+    this->check_json_arena();
+
+    this->write_tasks = "";
+    serializeJson(*this->json_arena, this->write_tasks);
+    if (*request == "[]")
+    {
+        *request = this->write_tasks;
+        return;
+    }
+
+    // Merge the two arrays: "[reads" + "," + "writes]"
+    request->remove(request->length() - 1);
+    *request += ',';
+    request->concat(this->write_tasks.c_str() + 1, this->write_tasks.length() - 1);
+}
+
+void Floker::flush_write_queue()
+{
+    // Without the multi handle the buffered writes are sent one by one, the failed ones are kept
+    unsigned short nb_sent = 0;
+    while (nb_sent < this->write_queue.size())
+    {
+        Pending_write &write = this->write_queue[nb_sent];
+        if (!this->server_ptr->write(write.topic_path, write.state))
+        {
+            // Retrying a write refused by the server (4xx) would block the queue for ever, it is dropped
+            int http_code = this->server_ptr->last_http_code;
+            if (http_code < 400 || http_code >= 500)
+                break;
+            FLOKER_LOG_ERROR("The write of " + write.topic_path + " is refused (" + String(http_code) + "), it is dropped.");
+        }
+        nb_sent++;
+    }
+    this->write_queue.erase_front(nb_sent);
+}
+
+void Floker::build_batch_body(String *request, bool with_states)
+{
+    JsonArray json_under_request_array = this->json_arena->to<JsonArray>();
+
+    for (unsigned short k = 0; k < this->batch_size; k++)
+    {
+        Channel *channel = this->batch_channel(k);
+        if (with_states)
+            Json_tools::add_watch_task(json_under_request_array, channel->topic_path, channel->state);
+        else
+            Json_tools::add_read_task(json_under_request_array, channel->topic_path);
+    }
+    this->check_json_arena();
+
+    *request = "";
+    serializeJson(*this->json_arena, *request);
+}
+
+bool Floker::prepare_multi_request(String *request, bool *subscribed)
+{
+    *subscribed = false;
+
+    // Nothing is due and nothing to write: no request
+    if (this->schedule_batch() == 0 && this->write_queue.size() == 0)
+        return false;
+
+    // Long poll: the known states are sent, the server compares them (without subscription or delta polling)
+    // Partial batch: only the due channels are read (without subscription or delta polling)
+    if (this->enable_long_poll || !this->batch_full)
+    {
+        this->build_batch_body(request, this->enable_long_poll);
+        this->append_write_tasks(request);
+        if (this->json_arena_overflow)
+            this->retry_batch();
+        return !this->json_arena_overflow;
+    }
+
+    // Get the pre-serialized request
+    this->build_multi_request_body();
+
+    // Subscription mode: the poll only carries the subscription id
+    *subscribed = this->enable_subscription && this->register_subscription();
+
+    if (*subscribed)
+        *request = "[]";
+    else
+        *request = this->multi_request_body;
+    this->append_write_tasks(request);
+
+    // An incomplete request is not sent, the arena is grown for the next cycle
+    if (this->json_arena_overflow)
+        this->retry_batch();
+    return !this->json_arena_overflow;
+}
+
+unsigned long Floker::get_hold_time()
+{
+    // The writes are answered immediately
+    return (this->enable_long_poll && this->write_queue.size() == 0) ? this->long_poll_timeout : 0;
+}
+
+bool Floker::use_revision()
+{
+    return this->enable_delta_polling && this->batch_full && !this->enable_long_poll;
+}
+
+void Floker::reset_revision()
+{
+    // Also the one of the response being dispatched: a callback can reset the revision
+    this->multi_revision = String("");
+    this->response_revision = String("");
+}
+
+void Floker::multi_request_failed(bool subscribed, Write_queue *sent_writes)
+{
+    // The server has forgotten the subscription (restart), register again on the next cycle
+    int http_code = this->server_ptr->last_http_code;
+    if (subscribed && (http_code == 404 || http_code == 410))
+        this->subscription_id = String("");
+
+    // Sent again, a refused write would block the polling for ever: it is dropped
+    // (except 404 / 410: unknown subscription, and 415: the request is sent again in JSON)
+    if (http_code >= 400 && http_code < 500 && http_code != 404 && http_code != 410 && http_code != 415 && sent_writes->size() > 0)
+    {
+        FLOKER_LOG_ERROR("The multi request is refused (" + String(http_code) + "), its " + String(sent_writes->size()) + " write(s) are dropped.");
+        sent_writes->clear();
+    }
+
+    this->retry_batch();
+}
+
+void Floker::dispatch_under_response(unsigned short index, const char *data)
+{
+    // Execute the callback function if it is necessary
+    if (index >= this->batch_size)
+        return;
+
+    Channel *channel = this->batch_channel(index);
+    FLOKER_LOG_DEBUG("\nTopic path: " + channel->topic_path);
+
+    this->update_channel(channel, data);
+}
+
+bool Floker::dispatch_msgpack_response(Stream *response_stream)
+{
+    // The channels have changed since the request, the indexes are no longer valid
+    unsigned long nb_responses;
+    if (this->batch_version != this->channels.version || !Json_tools::read_msgpack_array_header(response_stream, &nb_responses))
+        return false;
+
+    // Compact under responses [data, status(, index)] parsed one by one
+    JsonDocument &json_under_response = *this->json_arena;
+    for (unsigned long k = 0; k < nb_responses && this->batch_version == this->channels.version; k++)
+    {
+        DeserializationError parse_error = deserializeMsgPack(json_under_response, *response_stream);
+        if (parse_error)
+        {
+            FLOKER_LOG_ERROR("Parse response failed ! Error code: " + String(parse_error.c_str()));
+            this->json_arena_overflow = (parse_error == DeserializationError::NoMemory);
+            return false;
+        }
+
+        this->dispatch_under_response(json_under_response[2] | (unsigned short)k, Json_tools::get_text(json_under_response[0], &this->response_text));
+    }
+
+    return this->batch_version == this->channels.version;
+}
+
+bool Floker::dispatch_multi_response(Stream *response_stream)
+{
+    if (this->server_ptr->is_msgpack_response())
+        return this->dispatch_msgpack_response(response_stream);
+
+    // Only keep the data (and the channel index in delta mode) of each under response
+    StaticJsonDocument<32> json_filter;
+    json_filter["data"] = true;
+    json_filter["index"] = true;
+
+    // Parse the response array element by element, the memory used doesn't depend on the channels count
+    JsonDocument &json_under_response = *this->json_arena;
+    unsigned short k = 0;
+
+    if (!response_stream->find('['))
+        return false;
+
+    // The channels have changed since the request, the indexes are no longer valid
+    if (this->batch_version != this->channels.version)
+        return false;
+
+    char separator;
+    do
+    {
+        DeserializationError parse_error = deserializeJson(
+            json_under_response, *response_stream, DeserializationOption::Filter(json_filter));
+        if (parse_error)
+        {
+            FLOKER_LOG_ERROR("Parse response failed ! Error code: " + String(parse_error.c_str()));
+            this->json_arena_overflow = (parse_error == DeserializationError::NoMemory);
+            return false;
+        }
+
+        // Delta responses give the index of the channel, else the response is in the request order
+        this->dispatch_under_response(json_under_response["index"] | k, Json_tools::get_text(json_under_response["data"], &this->response_text));
+        k++;
+
+        if (this->batch_version != this->channels.version)
+            return false;
+        separator = Json_tools::read_separator(response_stream);
+    } while (separator == ',');
+
+    // Else the response is truncated (timeout, closed connection)
+    if (separator != ']')
+    {
+        FLOKER_LOG_ERROR("The multi response is incomplete.");
+        return false;
+    }
+    return true;
+}
+
+void Floker::multi_subscribed_channels_handle()
 {
-    String uri = this->start_url();
+    bool subscribed;
+    if (!this->prepare_multi_request(&this->multi_request, &subscribed))
+        return;
 
-    // Write Mode
-    if (topic != String("") && data_to_write != String(""))
+    // Send the Json request and get the stream of the Json response
+    Stream *response_stream;
+    const String *revision = this->use_revision() ? &this->multi_revision : NULL;
+    const String *subscription_id = subscribed ? &this->subscription_id : NULL;
+    if (!this->server_ptr->multi_tasks_stream(this->multi_request, &response_stream, revision, subscription_id, this->get_hold_time()))
     {
-        uri += String("write?");
-        uri += String("token=") + this->token;
-        uri += String("&topic=") + topic;
-        uri += String("&state=") + data_to_write;
+        this->multi_request_failed(subscribed, &this->write_queue);
+        return;
     }
 
-    // Read Mode
-    else if (topic != String(""))
+    // The buffered writes are sent, a failed request keep them for the next cycle
+    this->write_queue.clear();
+
+    // The callbacks can send requests, the revision of this response is kept aside
+    if (revision != NULL)
+        this->response_revision = this->server_ptr->get_etag();
+
+    // Delta polling or long poll timeout: nothing has changed
+    bool dispatched = true;
+    if (this->server_ptr->last_http_code == 304)
     {
-        uri += String("read?");
-        uri += String("token=") + this->token;
-        uri += String("&topic=") + topic;
-        uri += String("&parse=state");
+        FLOKER_LOG_DEBUG("No channel has changed.");
     }
-    // Multi action request mode
     else
-    {
-        uri += String("multi?");
-        uri += String("token=") + this->token;
-        uri += String("&parse=response");
-    }
+        dispatched = this->dispatch_multi_response(response_stream);
+
+    this->server_ptr->end_stream();
 
-    return uri;
+    // A partly dispatched response is asked again from the previous revision
+    if (revision != NULL && dispatched)
+        std::swap(this->multi_revision, this->response_revision);
 }
 
-bool Server_Manager::get_request(String uri, String *response, bool force_request)
+void Floker::async_multi_subscribed_channels_handle()
 {
-    // Open the connection
-    if (DEBUG_FLOKER_LIB)
-        Serial.println("Open get request:\nuri: " + uri);
-
-    this->http_client.begin(this->wifi_client, uri);
-
-    bool success = false;
-    while (!success)
+    // No request in flight: send the next one and return
+    if (!this->async_request_pending)
     {
-        // Send the request
-        int http_code = this->http_client.GET();
+        if (!this->prepare_multi_request(&this->multi_request, &this->async_subscribed))
+            return;
+        this->async_revision = this->use_revision();
+        const String *revision = this->async_revision ? &this->multi_revision : NULL;
+        unsigned long hold_time = this->get_hold_time();
 
-        // Get the request response
-        *response = this->http_client.getString();
+        // The queued writes are in flight, the new ones wait for the next request
+        this->write_queue.swap(&this->in_flight_writes);
 
-        if (DEBUG_FLOKER_LIB)
+        const String *subscription_id = this->async_subscribed ? &this->subscription_id : NULL;
+        if (!this->server_ptr->start_multi_tasks(this->multi_request, revision, subscription_id, hold_time))
         {
-            Serial.println("Response code: " + String(http_code));
-            if (http_code < 0)
-                Serial.println("The request can't be sent: " + String(this->http_client.errorToString(http_code)));
-            else if (http_code != 200)
-                Serial.println("The request was a failure !\nThe error response is :\n" + *response);
-            else
-                Serial.println("The request was a success, the data is: \n" + *response);
+            this->multi_request_failed(this->async_subscribed, &this->in_flight_writes);
+            this->write_queue.restore(&this->in_flight_writes);
+            return;
         }
 
-        success = (http_code == 200);
+        this->async_request_pending = true;
+        return;
+    }
 
-        // Quit the loop is the force request option is not asked
-        if (!force_request)
-            break;
+    // Read the part of the response already received
+    int http_code = this->server_ptr->poll_multi_tasks(&this->response);
+    if (http_code == FLOKER_PENDING)
+        return;
+
+    this->async_request_pending = false;
+    if (http_code != 200 && http_code != 304)
+    {
+        this->multi_request_failed(this->async_subscribed, &this->in_flight_writes);
+        this->write_queue.restore(&this->in_flight_writes);
+        return;
     }
 
-    // Close the connection
-    if (DEBUG_FLOKER_LIB)
-        Serial.println("End of the get request close the connection.");
+    this->in_flight_writes.clear();
 
-    this->http_client.end();
+    if (this->async_revision)
+        this->response_revision = this->server_ptr->get_etag();
 
-    return success;
+    // Dispatch the callbacks
+    bool dispatched = true;
+    if (http_code == 200)
+    {
+        String_stream response_stream;
+        response_stream.set_string(&this->response);
+        dispatched = this->dispatch_multi_response(&response_stream);
+    }
+
+    if (this->async_revision && dispatched)
+        std::swap(this->multi_revision, this->response_revision);
 }
 
-bool Server_Manager::post_request(String uri, String request, String *response, bool force_request)
+bool Floker::open_push()
 {
-    // Open the connection
-    if (DEBUG_FLOKER_LIB)
-        Serial.println("Open post request:\nuri: " + uri);
-
-    this->http_client.begin(this->wifi_client, uri);
-    this->http_client.addHeader("Content-Type", "application/json");
+    this->push_retry_time = millis();
 
-    bool success = false;
-    while (!success)
+    // The server streams the changes of the registered channels
+    this->build_multi_request_body();
+    if (!this->register_subscription() || !this->server_ptr->open_events(this->subscription_id))
     {
-        // TODO: il faut récupérer les status 1 à 1 des sous requees pour voir si elles sont marchées
-        // Send the request
-        int http_code = this->http_client.POST(request);
+        FLOKER_LOG_WARNING("The event stream can't be opened, the channels are polled.");
+        return false;
+    }
 
-        // Get the request response
-        *response = this->http_client.getString();
+    // The changes made while the stream was closed are missed
+    this->push_connected = true;
+    this->push_resync = true;
+    this->push_version = this->channels.version;
+    return true;
+}
 
-        if (DEBUG_FLOKER_LIB)
-        {
-            Serial.println("Response code: " + String(http_code));
-            if (http_code < 0)
-                Serial.println("The request can't be sent: " + String(this->http_client.errorToString(http_code)));
-            else if (http_code != 200)
-                Serial.println("The request was a failure !\nThe error response is :\n" + *response);
-            else
-                Serial.println("The request was a success, the data is: \n" + *response);
-        }
+void Floker::close_push()
+{
+    this->server_ptr->close_events();
+    this->push_connected = false;
+}
 
-        success = (http_code == 200);
+void Floker::resync_channels()
+{
+    // All the channels are due and the next delta poll get all the states
+    for (unsigned short k = 0; k < this->channels.size(); k++)
+        this->channels[k].next_poll = millis();
+    this->scheduler.invalidate();
+    this->reset_revision();
+}
 
-        // Quit the loop is the force request option is not asked
-        if (!force_request)
-            break;
+void Floker::dispatch_event(String data)
+{
+    // Event data: {"topic": "...", "state": "..."}
+    JsonDocument &json_event = *this->json_arena;
+    DeserializationError parse_error = deserializeJson(json_event, data);
+    if (parse_error)
+    {
+        FLOKER_LOG_ERROR("Parse event failed ! Error code: " + String(parse_error.c_str()));
+        this->json_arena_overflow = (parse_error == DeserializationError::NoMemory);
+        return;
     }
 
-    // Close the connection
-    if (DEBUG_FLOKER_LIB)
-        Serial.println("End of the post request close the connection.");
+    Channel *channel = this->channels.find(json_event["topic"] | "");
+    if (channel == NULL)
+        return;
 
-    this->http_client.end();
+    FLOKER_LOG_DEBUG("\nTopic path: " + channel->topic_path);
 
-    return success;
+    this->update_channel(channel, Json_tools::get_text(json_event["state"], &this->response_text));
 }
 
-// Public method(s)
-void Server_Manager::begin()
+void Floker::push_channels_handle()
 {
-    // Init WiFi connection
-    WiFi.begin(this->ssid, this->password);
-    if (DEBUG_FLOKER_LIB)
+    // The channels have changed, open the stream of the new subscription
+    if (this->push_connected && this->push_version != this->channels.version)
     {
-        Serial.print("Try to connect to ");
-        Serial.println(this->ssid);
-        Serial.print("Connecting");
+        this->close_push();
+        this->open_push();
     }
 
-    while (WiFi.status() != WL_CONNECTED)
+    // Poll the channels while the stream is closed
+    if (!this->push_connected && millis() - this->push_retry_time >= DEFAULT_PUSH_RETRY_INTERVAL)
+        this->open_push();
+    if (!this->push_connected)
     {
-        delay(500);
-        if (DEBUG_FLOKER_LIB)
-        {
-            Serial.print(".");
-        }
+        this->subscribed_channels_handle();
+        return;
+    }
+
+    // Get the states missed while the stream was closed, then only send the queued writes
+    if (this->push_resync)
+    {
+        this->push_resync = false;
+        this->resync_channels();
+        this->subscribed_channels_handle();
+    }
+    else if (this->async_request_pending || this->write_queue.size() > 0)
+        this->write_channels_handle();
+
+    // Dispatch the received changes
+    String data;
+    int event_code = FLOKER_PENDING;
+    for (unsigned short k = 0; k < DEFAULT_PUSH_MAX_EVENTS; k++)
+    {
+        event_code = this->server_ptr->poll_event(&data);
+        if (event_code != 200)
+            break;
+        this->dispatch_event(data);
     }
-    this->ip = WiFi.localIP().toString();
-    if (DEBUG_FLOKER_LIB)
+
+    if (event_code != 200 && event_code != FLOKER_PENDING)
     {
-        Serial.println("");
-        Serial.print("Connection is established ! Your ip is: ");
-        Serial.println(this->ip);
+        FLOKER_LOG_WARNING("The event stream is closed (" + String(event_code) + "), the channels are polled.");
+        this->close_push();
     }
 }
 
-bool Server_Manager::read(String topic_path, String *get_data, bool force)
+void Floker::poke_channels(String hints, bool all_channels)
 {
-    String uri = this->make_uri(topic_path);
-    return get_request(uri, get_data, force);
+    unsigned long now = millis();
+    for (unsigned short k = 0; k < this->channels.size(); k++)
+    {
+        // The not hinted channels skip this poll
+        if (all_channels)
+            this->channels[k].next_poll = now;
+        else if ((long)(now - this->channels[k].next_poll) >= 0)
+            this->channels[k].next_poll = now + 1;
+    }
+
+    // Hints: comma separated topics
+    int hint_start = 0;
+    while (!all_channels && hint_start < (int)hints.length())
+    {
+        int hint_end = hints.indexOf(',', hint_start);
+        if (hint_end < 0)
+            hint_end = hints.length();
+
+        Channel *channel = this->channels.find(hints.substring(hint_start, hint_end));
+        if (channel != NULL)
+            channel->next_poll = now;
+        hint_start = hint_end + 1;
+    }
+
+    this->scheduler.invalidate();
 }
 
-bool Server_Manager::write(String topic_path, String data_to_write, bool force)
+void Floker::poke_channels_handle()
 {
-    String uri = this->make_uri(topic_path, data_to_write);
-    String response;
-    return get_request(uri, &response, force);
+    // Without listener, the channels are polled on each handle
+    if (!this->poke_started)
+        this->poke_started = this->server_ptr->begin_poke(this->poke_port);
+    if (!this->poke_started)
+    {
+        this->subscribed_channels_handle();
+        return;
+    }
+
+    // Coalesce the received pokes, an empty one pokes all the channels
+    String hints, poke_hints;
+    bool poked = false;
+    bool all_channels = false;
+    while (this->server_ptr->read_poke(&poke_hints))
+    {
+        FLOKER_LOG_DEBUG("\nPoke received: " + poke_hints);
+
+        all_channels = all_channels || poke_hints == String("");
+        hints += (hints == String("")) ? poke_hints : String(",") + poke_hints;
+        poked = true;
+    }
+
+    // Slow background poll of all the channels
+    if (millis() - this->poke_poll_time >= this->poke_background_interval)
+    {
+        this->poke_poll_time = millis();
+        this->poke_channels(String(""), true);
+        this->poke_pending = true;
+    }
+    else if (poked)
+    {
+        this->poke_channels(hints, all_channels);
+        this->poke_pending = true;
+    }
+
+    // The poked channels are sent with the next request (after the one in flight),
+    // the writes alone don't poll the channels
+    if (this->poke_pending && !this->async_request_pending)
+    {
+        this->poke_pending = false;
+        this->subscribed_channels_handle();
+    }
+    else if (this->async_request_pending || this->write_queue.size() > 0)
+        this->write_channels_handle();
 }
 
-bool Server_Manager::multi_tasks(String request, String *response, bool force)
+void Floker::subscribed_channels_handle()
 {
-    String uri = this->make_uri();
-    return post_request(uri, request, response, force);
+    if (this->enable_multi_handle && this->enable_async_handle)
+        this->async_multi_subscribed_channels_handle();
+    else if (this->enable_multi_handle)
+        this->multi_subscribed_channels_handle();
+    else
+    {
+        this->flush_write_queue();
+        this->classic_subscribed_channels_handle();
+    }
 }
 
-#pragma endregion
-
-// Software_polling
-#pragma region Software_polling
-// Constructor
-Software_polling::Software_polling(
-    String connection_state_topic_path,
-    String connection_interval_topic_path,
-    String connection_type_topic_path,
-    String connection_version_topic_path,
-    String connection_ip_topic_path)
+void Floker::write_channels_handle()
 {
-    this->connection_state_topic_path = connection_state_topic_path;
-    this->connection_interval_topic_path = connection_interval_topic_path;
-    this->connection_type_topic_path = connection_type_topic_path;
-    this->connection_version_topic_path = connection_version_topic_path;
-    this->connection_ip_topic_path = connection_ip_topic_path;
+    this->writes_only = true;
+    this->subscribed_channels_handle();
+    this->writes_only = false;
 }
-// Public: Begin and Handle functions
-void Software_polling::handle(Server_Manager *server_ptr)
+
+void Floker::schedule_retry(const String &topic_path, const String &state)
 {
-    // Execute all request in force mode
-    if (millis() - this->last_connection_update > global_connection_update_interval || !this->static_information_pushed)
+    if (this->server_ptr->retry_policy.max_attempts <= 1)
+        return;
+
+    // The first failed write starts the attempts count
+    if (this->retry_queue.size() == 0)
     {
-        this->last_connection_update = millis();
-        server_ptr->write(this->connection_state_topic_path, "connected", true);
+        this->retry_attempt = 1;
+        this->retry_start = millis();
+        this->retry_time = this->retry_start;
+        this->retry_delay = this->server_ptr->retry_policy.get_delay(1);
+    }
+
+    if (!this->retry_queue.push(topic_path, state))
+        FLOKER_LOG_ERROR("The write of " + topic_path + " can't be retried, the retry queue is full.");
+}
 
-        if (!this->static_information_pushed)
+void Floker::retry_writes_handle()
+{
+    if (this->retry_queue.size() == 0 || millis() - this->retry_time < this->retry_delay)
+        return;
+
+    // Same as the write queue flush: the failed writes are kept, the refused ones (4xx) are dropped
+    unsigned short nb_sent = 0;
+    while (nb_sent < this->retry_queue.size())
+    {
+        Pending_write &write = this->retry_queue[nb_sent];
+        this->server_ptr->metrics.nb_retries++;
+        if (!this->server_ptr->write(write.topic_path, write.state))
         {
-            // Update the refresh interval for the polling update
-            String interval;
-            server_ptr->read(this->connection_interval_topic_path, &interval, true);
-            global_connection_update_interval = interval.toInt();
-            // Send static device informations
-            server_ptr->write(this->connection_type_topic_path, server_ptr->device_type, true);
-            server_ptr->write(this->connection_version_topic_path, FLOLIB_FLOKER_VERSION, true);
-            server_ptr->write(this->connection_ip_topic_path, server_ptr->ip, true);
-            this->static_information_pushed = true;
+            int http_code = this->server_ptr->last_http_code;
+            if (http_code < 400 || http_code >= 500)
+                break;
+            FLOKER_LOG_ERROR("The write of " + write.topic_path + " is refused (" + String(http_code) + "), it is dropped.");
         }
+        nb_sent++;
+    }
+    this->retry_queue.erase_front(nb_sent);
+    if (this->retry_queue.size() == 0)
+        return;
+
+    // Next attempt, unless the attempts or the time are exhausted
+    Retry_policy &retry_policy = this->server_ptr->retry_policy;
+    this->retry_attempt++;
+    this->retry_time = millis();
+    this->retry_delay = retry_policy.get_delay(this->retry_attempt);
+    if (this->retry_attempt >= retry_policy.max_attempts || this->retry_time - this->retry_start + this->retry_delay > retry_policy.deadline)
+    {
+        FLOKER_LOG_ERROR(String(this->retry_queue.size()) + " force write(s) failed after " + String(this->retry_attempt) + " attempts, they are dropped.");
+        this->retry_queue.clear();
     }
 }
 
-Channel Software_polling::create_interval_channel()
+// Public method(s)
+void Floker::set_port(unsigned short port)
 {
-    return Channel(
-        this->connection_interval_topic_path,
-        this->update_polling_interval,
-        String(global_connection_update_interval));
+    this->server_ptr->port = port;
 }
-#pragma endregion
 
-#pragma region Floker
-// Constructor
-Floker::Floker(
-    const char *ssid,
-    const char *password,
-    bool secure_connection,
-    String server,
-    String root_path,
-    String token,
-    String device_path)
+void Floker::set_multi_handle(bool enable_multi_handle)
 {
-    this->server_ptr = new Server_Manager(
-        ssid, password,
-        secure_connection ? String(HTTPS_REQUEST) : String(HTTP_REQUEST),
-        server,
-        secure_connection ? HTTPS_PORT : HTTP_PORT,
-        root_path,
-        token,
-        device_path);
+    this->enable_multi_handle = enable_multi_handle;
 }
 
-// Private method(s)
-String Floker::get_path(String path, bool autocomplete)
+void Floker::set_async_handle(bool enable_async_handle)
 {
-    // Patern device path is set
-    if (autocomplete && this->server_ptr->device_path != String(""))
-        path = DEFAULT_START_IOT_PATH + this->server_ptr->device_path + path;
-    return path;
+    this->enable_async_handle = enable_async_handle;
 }
 
-void Floker::classic_subscribed_channels_handle()
+void Floker::set_buffered_write(bool enable_buffered_write)
 {
-    for (unsigned short k = 0; k < this->nb_channels; k++)
-    {
-        if (DEBUG_FLOKER_LIB)
-        {
-            Serial.println();
-            Serial.print("Topic path: ");
-            Serial.println(this->channels_ptr[k].topic_path);
-        }
-
-        String response;
-
-        if (this->read(this->channels_ptr[k].topic_path, &response, false))
-        {
-            if (DEBUG_FLOKER_LIB)
-            {
-                Serial.print("State ------> ");
-                Serial.println(response);
-                Serial.print("Old state --> ");
-                Serial.println(this->channels_ptr[k].state);
-            }
+    this->enable_buffered_write = enable_buffered_write;
+}
 
-            // Check if the state have changed
-            if (String(this->channels_ptr[k].state) != response)
-            {
-                if (DEBUG_FLOKER_LIB)
-                {
-                    Serial.println("The state have changed, let's execute the callback function !");
-                }
-                this->channels_ptr[k].function(response);
-                this->channels_ptr[k].state = response;
-            }
-            else if (DEBUG_FLOKER_LIB)
-            {
-                Serial.println("The state have not changed.");
-            }
-        }
-    }
+void Floker::set_subscription(bool enable_subscription)
+{
+    this->enable_subscription = enable_subscription;
+    this->subscription_supported = true;
+    this->subscription_id = String("");
 }
 
-void Floker::multi_subscribed_channels_handle()
+void Floker::set_delta_polling(bool enable_delta_polling)
 {
-    // Create Json request
-    DynamicJsonDocument json_request(this->nb_channels * DEFAULT_UNDER_REQUEST_SIZE);
-    JsonArray json_under_request_array = json_request.to<JsonArray>();
+    this->enable_delta_polling = enable_delta_polling;
+    this->reset_revision();
+}
 
-    // All request here are "read" request
-    for (unsigned short k = 0; k < this->nb_channels; k++)
-        json_under_request_array.add(Json_tools::make_read_json(this->channels_ptr[k].topic_path));
+void Floker::set_long_poll(bool enable_long_poll, unsigned long timeout)
+{
+    this->enable_long_poll = enable_long_poll;
+    this->long_poll_timeout = timeout;
+}
 
-    // Send the Json request and get the Json response
-    DynamicJsonDocument json_response(this->nb_channels * DEFAULT_UNDER_RESPONSE_SIZE);
+void Floker::set_push(bool enable_push)
+{
+    if (!enable_push && this->push_connected)
+        this->close_push();
 
-    if (this->multi_tasks(json_request, &json_response))
-    {
+    // The stream is opened on the next handle()
+    this->enable_push = enable_push;
+    this->push_retry_time = millis() - DEFAULT_PUSH_RETRY_INTERVAL;
+}
 
-        // Execute all callback function if it is necessary
-        JsonArray json_response_array = json_response.as<JsonArray>();
-        for (unsigned short k = 0; k < this->nb_channels; k++)
-        {
-            if (DEBUG_FLOKER_LIB)
-                Serial.println("\nTopic path: " + String(this->channels_ptr[k].topic_path));
+void Floker::set_poke(bool enable_poke, unsigned short port, unsigned long background_interval)
+{
+    this->enable_poke = enable_poke;
+    this->poke_port = port;
+    this->poke_background_interval = background_interval;
 
-            JsonObject under_request_response = json_response_array[k];
-            String state = under_request_response["data"].as<String>();
-            if (DEBUG_FLOKER_LIB)
-                Serial.println("State ------> " + String(state) + "\nOld state --> " + String(this->channels_ptr[k].state));
+    // The listener is started on the next handle() and all the channels are polled
+    this->poke_started = false;
+    this->poke_poll_time = millis() - background_interval;
+}
 
-            // Check if the state have changed
-            if (this->channels_ptr[k].state != state)
-            {
-                if (DEBUG_FLOKER_LIB)
-                    Serial.println("The state have changed, let's execute the callback function !");
+void Floker::set_msgpack(bool enable_msgpack)
+{
+    this->server_ptr->enable_msgpack = enable_msgpack;
+    this->server_ptr->msgpack_supported = true;
+}
 
-                this->channels_ptr[k].function(state);
-                this->channels_ptr[k].state = state;
-            }
-            else if (DEBUG_FLOKER_LIB)
-                Serial.println("The state have not changed.");
-        }
+void Floker::set_metrics_publishing(unsigned long interval, String metrics_path)
+{
+    if (!this->enable_software_polling)
+    {
+        FLOKER_LOG_WARNING("The metrics are published with the connection polling, call set_connection_polling() first.");
+        return;
     }
 
-    Serial.println(" json_under_request: ");
-    serializeJson(json_request, Serial);
-    Serial.println("\n json_response: ");
-    serializeJson(json_response, Serial);
-
-    Serial.println(" ");
+    this->software_polling_ptr->set_metrics_publishing(this->connection_polling_path + metrics_path, interval);
 }
 
-void Floker::subscribed_channels_handle()
+void Floker::set_transport(Transport *transport_ptr)
 {
-    if (this->enable_multi_handle)
-        this->multi_subscribed_channels_handle();
-    else
-        this->classic_subscribed_channels_handle();
+    this->server_ptr->set_transport(transport_ptr);
 }
 
-// Public method(s)
-void Floker::set_port(unsigned short port)
+void Floker::set_retry_policy(unsigned short max_attempts, unsigned long base_delay, unsigned long max_delay, unsigned long deadline)
 {
-    this->server_ptr->port = port;
+    this->server_ptr->retry_policy = Retry_policy(max_attempts, base_delay, max_delay, deadline);
 }
 
-void Floker::set_multi_handle(bool enable_multi_handle)
+void Floker::set_circuit_breaker(unsigned short failure_threshold, unsigned long open_interval)
 {
-    this->enable_multi_handle = enable_multi_handle;
+    this->server_ptr->circuit_breaker = Circuit_breaker(failure_threshold, open_interval);
 }
 
 void Floker::set_connection_polling(
@@ -520,6 +4116,8 @@ void Floker::set_connection_polling(
     // IP
     String ip_topic_path = base_path + state_ip_path;
 
+    this->connection_polling_path = base_path;
+
     this->software_polling_ptr = new Software_polling(
         state_topic_path,
         interval_topic_path,
@@ -528,69 +4126,192 @@ void Floker::set_connection_polling(
         ip_topic_path);
 }
 
-void Floker::begin()
+void Floker::start(const unsigned char *)
 {
     // Init Serial
-    if (DEBUG_FLOKER_LIB && !Serial)
+    if (FLOKER_LOG_LEVEL > FLOKER_LOG_LEVEL_NONE && !Serial)
         Serial.begin(DEFAULT_SERIAL_BAUDRATE);
 
     // Init connection polling channel
     if (this->enable_software_polling)
-    {
-        this->nb_channels++;
-        this->channels_ptr = Channel::push_channel_to_array(
-            this->channels_ptr,
-            this->software_polling_ptr->create_interval_channel(),
-            this->nb_channels);
-    }
+        this->software_polling_ptr->subscribe_interval_channel(&this->channels);
 
-    // Init WiFi connection
+    // The handle buffers and the JSON arena are sized from the subscribed channels
+    this->reserve_buffers();
+
+    // Start the WiFi connection (non-blocking, it is advanced by handle())
     this->server_ptr->begin();
 }
 
 void Floker::handle()
 {
-    if (this->enable_software_polling)
-        this->software_polling_ptr->handle(this->server_ptr);
+    this->server_ptr->metrics.record_heap(false);
 
-    this->subscribed_channels_handle();
+    // Advance the WiFi connection, skip the cycle while it is not connected
+    if (this->server_ptr->handle_connection())
+    {
+        if (this->enable_software_polling)
+            this->software_polling_ptr->handle(this->server_ptr, &this->write_queue, this->json_arena);
+
+        // Sized with the writes queued by the software polling
+        this->reset_json_arena();
+
+        this->retry_writes_handle();
+        this->release_held_channels();
+
+        if (this->enable_push)
+            this->push_channels_handle();
+        else if (this->enable_poke)
+            this->poke_channels_handle();
+        else
+            this->subscribed_channels_handle();
+    }
+
+    this->server_ptr->metrics.record_heap(true);
 }
 
-void Floker::subscribe(String topic_path, void (*function)(String data), bool autocomplete_topic)
+void Floker::subscribe(String topic_path, void (*function)(String data), bool autocomplete_topic, unsigned long poll_period)
 {
-    this->nb_channels++;
-    this->channels_ptr = Channel::push_channel_to_array(
-        this->channels_ptr,
-        Channel(this->get_path(topic_path, autocomplete_topic), (*function)),
-        this->nb_channels);
+    Channel *channel = this->add_channel(topic_path, autocomplete_topic, poll_period);
+    if (channel == NULL)
+        return;
+
+    channel->function = function;
+}
+
+void Floker::subscribe(String topic_path, void (*function)(const char *data), bool autocomplete_topic, unsigned long poll_period)
+{
+    Channel *channel = this->add_channel(topic_path, autocomplete_topic, poll_period);
+    if (channel == NULL)
+        return;
+
+    channel->text_function = function;
+}
+
+void Floker::subscribe(String topic_path, Channel_function function, void *context, bool autocomplete_topic, unsigned long poll_period)
+{
+    Channel *channel = this->add_channel(topic_path, autocomplete_topic, poll_period);
+    if (channel == NULL)
+        return;
+
+    channel->view_function = function;
+    channel->context = context;
+}
+
+Channel *Floker::subscribe_typed(String topic_path, Channel::Value_type type, void (*function)(), void (*call)(void (*function)(), Channel_value value), bool autocomplete_topic, unsigned long poll_period)
+{
+    Channel *channel = this->add_channel(topic_path, autocomplete_topic, poll_period);
+    if (channel == NULL)
+        return NULL;
+
+    channel->type = type;
+    channel->typed_function = function;
+    channel->typed_call = call;
+    return channel;
+}
+
+bool Floker::unsubscribe(String topic_path, bool autocomplete_topic)
+{
+    return this->channels.remove(this->get_path(topic_path, autocomplete_topic));
+}
+
+bool Floker::set_read_filter(String topic_path, float deadband, float hysteresis, unsigned long min_interval, bool autocomplete_topic)
+{
+    Channel *channel = this->channels.find(this->get_path(topic_path, autocomplete_topic));
+    if (channel == NULL || channel->type == Channel::TEXT_VALUE)
+    {
+        FLOKER_LOG_WARNING("The filters need a typed channel, subscribe it first with a typed callback.");
+        return false;
+    }
+
+    channel->deadband = deadband;
+    channel->hysteresis = hysteresis;
+    channel->min_interval = min_interval;
+    return true;
 }
 
-bool Floker::read(String topic_path, String *get_data, bool autocomplete_topic, bool force_request)
+bool Floker::read(String topic_path, String *get_data, bool autocomplete_topic)
 {
     topic_path = this->get_path(topic_path, autocomplete_topic);
-    return this->server_ptr->read(topic_path, get_data, force_request);
+    return this->server_ptr->read(topic_path, get_data);
 }
 
 bool Floker::write(String topic_path, String data_to_write, bool autocomplete_topic, bool force_request)
 {
-    toploker::multi_tasks(DynamicJsonDocument request, DynamicJsonDocument * response, bool force_request)
+    topic_path = this->get_path(topic_path, autocomplete_topic);
+
+    // Buffered write: sent with the next handle() cycle
+    if (this->enable_buffered_write && !force_request)
     {
-        String str_response;
-        String str_request;
-        serializeJson(request, str_request);
-        bool success = this->server_ptr->multi_tasks(str_request, &str_response, force_request);
+        return this->write_queue.push(topic_path, data_to_write);
+    }
 
-        if (success)
-        {
-            // Get the deserialize request's response
-            Deserialiic_path = this->get_path(topic_path, autocomplete_topic);
-            return this->server_ptr->write(topic_path, data_to_write, force_request);
-        }
+    bool success = this->server_ptr->write(topic_path, data_to_write);
+
+    // A failed force write is retried by handle(), unless the server refused it (4xx)
+    int http_code = this->server_ptr->last_http_code;
+    if (success)
+        // The value waiting for its retry is outdated
+        this->retry_queue.remove(topic_path);
+    else if (force_request && (http_code < 400 || http_code >= 500))
+        this->schedule_retry(topic_path, data_to_write);
+
+    return success;
+}
+
+bool Floker::write_value(String topic_path, float value, unsigned char decimals, bool autocomplete_topic, bool force_request)
+{
+    topic_path = this->get_path(topic_path, autocomplete_topic);
+
+    Write_filter *filter = this->write_filters.find(topic_path);
+    if (filter != NULL && !force_request && !this->write_filters.accept(filter, value))
+    {
+        this->server_ptr->metrics.nb_filtered_writes++;
+        return true;
+    }
+
+    if (!this->write(topic_path, String(value, decimals), false, force_request))
+        return false;
+
+    if (filter != NULL)
+        this->write_filters.written(filter, value);
+    return true;
+}
+
+void Floker::set_write_filter(String topic_path, float deadband, unsigned long max_age, bool autocomplete_topic)
+{
+    this->write_filters.set(this->get_path(topic_path, autocomplete_topic), deadband, max_age);
+}
+
+bool Floker::multi_tasks(DynamicJsonDocument request, DynamicJsonDocument *response)
+{
+    String str_request;
+    serializeJson(request, str_request);
+    return this->multi_tasks(str_request, response);
+}
+
+bool Floker::multi_tasks(String request, DynamicJsonDocument *response)
+{
+    String str_response;
+    bool success = this->server_ptr->multi_tasks(request, &str_response);
 
-        bool FzationError parse_error = deserializeJson(*response, str_response);
+    if (success && this->server_ptr->is_msgpack_response())
+    {
+        // Give the response in its JSON form
+        DynamicJsonDocument json_compact_response(str_response.length() * 4 + DEFAULT_UNDER_RESPONSE_SIZE);
+        DeserializationError parse_error = deserializeMsgPack(json_compact_response, str_response.c_str(), str_response.length());
+        Json_tools::expand_responses(json_compact_response.as<JsonArray>(), response->to<JsonArray>());
+
+        if (parse_error)
+            FLOKER_LOG_ERROR("Parse response failed ! Error code: " + String(parse_error.c_str()));
+    }
+    else if (success)
+    {
+        // Get the deserialize request's response
+        DeserializationError parse_error = deserializeJson(*response, str_response);
 
-        if (DEBUG_FLOKER_LIB && parse_error)
-            Serial.println("Parse response failed ! Error code: " + String(parse_error.c_str()));
+        if (parse_error)
+            FLOKER_LOG_ERROR("Parse response failed ! Error code: " + String(parse_error.c_str()));
     }
 
     return success;
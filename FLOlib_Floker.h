@@ -1,10 +1,29 @@
+#if !defined(ESP32_ENABLED) && !defined(HOST_ENABLED)
 #define ESP8266_ENABLED
-#define DEBUG_FLOKER_LIB true
+#endif
+// Debug messages of the library, set it (or FLOKER_LOG_LEVEL) as a compiler flag
+#ifndef DEBUG_FLOKER_LIB
+#define DEBUG_FLOKER_LIB false
+#endif
+
+// Log levels: the messages above FLOKER_LOG_LEVEL are removed at compile time with their String building
+#define FLOKER_LOG_LEVEL_NONE 0
+#define FLOKER_LOG_LEVEL_ERROR 1
+#define FLOKER_LOG_LEVEL_WARNING 2
+#define FLOKER_LOG_LEVEL_INFO 3
+#define FLOKER_LOG_LEVEL_DEBUG 4
+#ifndef FLOKER_LOG_LEVEL
+#if DEBUG_FLOKER_LIB
+#define FLOKER_LOG_LEVEL FLOKER_LOG_LEVEL_DEBUG
+#else
+#define FLOKER_LOG_LEVEL FLOKER_LOG_LEVEL_WARNING
+#endif
+#endif
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
 
-#define FLOLIB_FLOKER_VERSION "3.0.0"
+#define FLOLIB_FLOKER_VERSION "3.1.0"
 
 #define HTTPS_REQUEST "https://"
 #define HTTP_REQUEST "http://"
@@ -17,27 +36,191 @@
 #define DEFAULT_TYPE_POLLING_PATH "/type"
 #define DEFAULT_VERSION_POLLING_PATH "/version"
 #define DEFAULT_IP_POLLING_PATH "/ip"
+#define DEFAULT_METRICS_POLLING_PATH "/metrics"
+#define DEFAULT_METRICS_INTERVAL 60000
+
+// Latency histogram: the bucket k counts the latencies under DEFAULT_LATENCY_BUCKET_BASE * 2^k ms, the last one the others
+#define NB_LATENCY_BUCKETS 8
+#define DEFAULT_LATENCY_BUCKET_BASE 25
+// Metrics JSON: the root, requests, latency, histogram, filtered and heap members (the keys are not copied)
+#define METRICS_JSON_SIZE (JSON_OBJECT_SIZE(9) + JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(NB_LATENCY_BUCKETS) + JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(5))
 
 #define DEFAULT_START_IOT_PATH "iot/"
 
 #define DEFAULT_UNDER_REQUEST_SIZE 512
 #define DEFAULT_UNDER_RESPONSE_SIZE 512
+#define DEFAULT_SUBSCRIPTION_RESPONSE_SIZE 128
+// Room added to the largest known state (and the keys) for the parsed responses of the JSON arena
+#define DEFAULT_JSON_ARENA_MARGIN 64
+// The longer URIs are not sent (414), the large states are written with a multi request
+// Can be set as a compiler flag of all the files
+#ifndef DEFAULT_URI_SIZE
+#define DEFAULT_URI_SIZE 256
+#endif
 
 #define DEFAULT_SERIAL_BAUDRATE 115200
 
+#define JSON_CONTENT_TYPE "application/json"
+#define MSGPACK_CONTENT_TYPE "application/msgpack"
+
+// Task types of the compact (MessagePack) multi requests
+#define FLOKER_READ_TASK 0
+#define FLOKER_WRITE_TASK 1
+
+#define DEFAULT_CHANNELS_CAPACITY 4
+#define DEFAULT_WRITE_QUEUE_CAPACITY 4
+#define DEFAULT_WRITE_FILTERS_CAPACITY 4
+
+// Static memory mode: the capacities are fixed at compile time, the buffers are allocated
+// when the channels are subscribed and by begin(), then handle() doesn't allocate
+// #define FLOKER_STATIC_MEMORY
+#ifdef FLOKER_STATIC_MEMORY
+#ifndef FLOKER_MAX_CHANNELS
+#define FLOKER_MAX_CHANNELS 16
+#endif
+#ifndef FLOKER_MAX_WRITES
+#define FLOKER_MAX_WRITES 8
+#endif
+// Including the terminating null: the longer topics are not subscribed, the longer states are ignored
+#ifndef FLOKER_TOPIC_SIZE
+#define FLOKER_TOPIC_SIZE 64
+#endif
+#ifndef FLOKER_STATE_SIZE
+#define FLOKER_STATE_SIZE 64
+#endif
+// Serialized multi request
+#ifndef FLOKER_REQUEST_SIZE
+#define FLOKER_REQUEST_SIZE 1024
+#endif
+#ifndef FLOKER_JSON_ARENA_SIZE
+#define FLOKER_JSON_ARENA_SIZE 2048
+#endif
+#endif
+
+// The classes layout depends on FLOKER_STATIC_MEMORY, FLOKER_JSON_ARENA_SIZE and DEFAULT_URI_SIZE: the library
+// defines a symbol named after them and begin() uses it, a file compiled with other flags doesn't link
+#define FLOKER_CONCAT(a, b) a##_##b
+#define FLOKER_CONFIG_NAME(a, b) FLOKER_CONCAT(a, b)
+#ifdef FLOKER_STATIC_MEMORY
+#define FLOKER_CONFIG_SYMBOL FLOKER_CONFIG_NAME(FLOKER_CONFIG_NAME(floker_config_static, FLOKER_JSON_ARENA_SIZE), DEFAULT_URI_SIZE)
+#else
+#define FLOKER_CONFIG_SYMBOL FLOKER_CONFIG_NAME(floker_config_dynamic, DEFAULT_URI_SIZE)
+#endif
+extern const unsigned char FLOKER_CONFIG_SYMBOL;
+
+#define DEFAULT_RETRY_MAX_ATTEMPTS 5
+#define DEFAULT_RETRY_BASE_DELAY 100
+#define DEFAULT_RETRY_MAX_DELAY 5000
+#define DEFAULT_RETRY_DEADLINE 15000
+
+#define DEFAULT_ASYNC_READ_SIZE 256
+#define DEFAULT_ASYNC_TIMEOUT 5000
+#define DEFAULT_HTTP_TIMEOUT 5000
+// Returned by the asynchronous polls while the response is not complete
+#define FLOKER_PENDING 1
+// Returned by poll_event() when the event stream is closed or silent for too long
+#define FLOKER_EVENTS_CLOSED -100
+
+// The server must send an event or a comment (keep-alive) within DEFAULT_PUSH_TIMEOUT
+#define DEFAULT_PUSH_TIMEOUT 60000
+#define DEFAULT_PUSH_RETRY_INTERVAL 10000
+#define DEFAULT_PUSH_MAX_EVENTS 8
+
+#define DEFAULT_POKE_PORT 4210
+#define DEFAULT_POKE_BACKGROUND_INTERVAL 60000
+#define DEFAULT_POKE_SIZE 256
+
+#define DEFAULT_WIFI_CONNECT_TIMEOUT 15000
+#define DEFAULT_WIFI_RETRY_INTERVAL 5000
+
+#define DEFAULT_BREAKER_FAILURE_THRESHOLD 3
+#define DEFAULT_BREAKER_OPEN_INTERVAL 10000
+
+// The ESP HTTP client timeout is limited to 65535 ms (with DEFAULT_HTTP_TIMEOUT)
+#define DEFAULT_LONG_POLL_TIMEOUT 25000
+
 static unsigned long global_connection_update_interval = 10000;
 
 // Device type detection call associated libraries
 #ifdef ESP8266_ENABLED
 #include <ESP8266WiFi.h>
 #include <ESP8266HTTPClient.h>
+#include <WiFiUdp.h>
 #define FLOKER_DEVICE_TYPE "esp8266"
 #endif
 #ifdef ESP32_ENABLED
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <WiFiUdp.h>
 #define FLOKER_DEVICE_TYPE "esp32"
 #endif
+#ifdef HOST_ENABLED
+#define FLOKER_DEVICE_TYPE "host"
+#define FLOKER_HOST_IP "127.0.0.1"
+#endif
+#if defined(ESP8266_ENABLED) || defined(ESP32_ENABLED)
+#define FLOKER_WIFI_ENABLED
+#endif
+
+#pragma region Log
+// Output of the log messages
+typedef void (*Floker_log_sink)(unsigned char level, const String &message);
+
+class Floker_log
+{
+private:
+    static Floker_log_sink sink;
+
+    // Rate limit: at most max_messages every interval (0: no limit), the dropped ones are counted
+    static unsigned short max_messages;
+    static unsigned long interval;
+    static unsigned long window_start;
+    static unsigned short nb_messages;
+    static unsigned long nb_dropped;
+
+    static void serial_sink(unsigned char level, const String &message);
+
+public:
+    // Runtime level, below the compile time FLOKER_LOG_LEVEL
+    static unsigned char level;
+
+    // NULL: the messages are printed on Serial
+    static void set_sink(Floker_log_sink sink);
+    static void set_rate_limit(unsigned short max_messages, unsigned long interval);
+
+    // Checked before the message is built
+    static bool accept(unsigned char level);
+    static void write(unsigned char level, const String &message);
+};
+
+#define FLOKER_LOG(level, message)              \
+    do                                          \
+    {                                           \
+        if (Floker_log::accept(level))          \
+            Floker_log::write(level, message);  \
+    } while (0)
+
+#if FLOKER_LOG_LEVEL >= FLOKER_LOG_LEVEL_ERROR
+#define FLOKER_LOG_ERROR(message) FLOKER_LOG(FLOKER_LOG_LEVEL_ERROR, message)
+#else
+#define FLOKER_LOG_ERROR(message) do {} while (0)
+#endif
+#if FLOKER_LOG_LEVEL >= FLOKER_LOG_LEVEL_WARNING
+#define FLOKER_LOG_WARNING(message) FLOKER_LOG(FLOKER_LOG_LEVEL_WARNING, message)
+#else
+#define FLOKER_LOG_WARNING(message) do {} while (0)
+#endif
+#if FLOKER_LOG_LEVEL >= FLOKER_LOG_LEVEL_INFO
+#define FLOKER_LOG_INFO(message) FLOKER_LOG(FLOKER_LOG_LEVEL_INFO, message)
+#else
+#define FLOKER_LOG_INFO(message) do {} while (0)
+#endif
+#if FLOKER_LOG_LEVEL >= FLOKER_LOG_LEVEL_DEBUG
+#define FLOKER_LOG_DEBUG(message) FLOKER_LOG(FLOKER_LOG_LEVEL_DEBUG, message)
+#else
+#define FLOKER_LOG_DEBUG(message) do {} while (0)
+#endif
+#pragma endregion
 
 #pragma region Json Tools
 class Json_tools
@@ -48,11 +231,53 @@ public:
     static DynamicJsonDocument make_task_json(String type, String topic, DynamicJsonDocument *params = NULL);
 
     static DynamicJsonDocument make_read_json(String topic);
+    // Append the task in place, without intermediate document
+    static void add_read_task(JsonArray tasks, const String &topic);
+    static void add_write_task(JsonArray tasks, const String &topic, const String &state);
+    // Read task carrying the state known by the device (long poll)
+    static void add_watch_task(JsonArray tasks, const String &topic, const String &state);
+    // Text of a value: the strings are given in place, the other values are serialized in the buffer
+    static const char *get_text(JsonVariantConst value, String *buffer);
+
+    // Compact form of the multi requests: task [type, topic(, state)] and response [data, status(, index)]
+    static void compact_tasks(JsonArray tasks, JsonArray compact_tasks);
+    static void expand_tasks(JsonArray compact_tasks, JsonArray tasks);
+    static void compact_responses(JsonArray responses, JsonArray compact_responses);
+    static void expand_responses(JsonArray compact_responses, JsonArray responses);
+
+    // MessagePack serialized in a String (the '\0' bytes are kept), false if the buffer can't be allocated
+    static bool to_msgpack(const JsonDocument &json, String *msgpack);
+    // Read the header of a MessagePack array to parse its elements one by one
+    static bool read_msgpack_array_header(Stream *stream, unsigned long *size);
+    // Next character after the blanks of a Json array (',' or ']'), 0 if the stream ends
+    static char read_separator(Stream *stream);
     static DynamicJsonDocument make_write_json(String topic, String state);
 };
 #pragma endregion
 
 #pragma region Channel
+// State given in place to the callbacks (null-terminated, only valid during the call: copy it to keep it)
+struct State_view
+{
+    const char *data;
+    size_t length;
+
+    inline bool equals(const char *text) const { return strlen(text) == this->length && strncmp(this->data, text, this->length) == 0; }
+    inline String to_string() const { return String(this->data); }
+};
+
+class Channel;
+// Callback with a user context, the new and old states and the channel (not valid after a subscribe / unsubscribe in the call)
+typedef void (*Channel_function)(void *context, const Channel &channel, State_view state, State_view old_state);
+
+// Native value of the typed channels (the enums are stored as the index of their name)
+union Channel_value
+{
+    long integer;
+    float real;
+    bool boolean;
+};
+
 class Channel
 {
 public:
@@ -60,13 +285,681 @@ public:
     String topic_path;
     String state;
     void (*function)(String data);
+    // Called instead of function, with the state in place (no String copy)
+    void (*text_function)(const char *data) = NULL;
+    // Called instead of function and text_function, with the given context
+    Channel_function view_function = NULL;
+    void *context = NULL;
+
+    // Typed channels: the state is parsed once when its text changes and compared as a value
+    // (the text state is still kept, the watch requests send it back)
+    enum Value_type
+    {
+        TEXT_VALUE,
+        INT_VALUE,
+        FLOAT_VALUE,
+        BOOL_VALUE,
+        ENUM_VALUE
+    };
+    Value_type type = TEXT_VALUE;
+    Channel_value value;
+    bool has_value = false;
+    const char *const *enum_names = NULL;
+    unsigned short nb_enum_names = 0;
+    // Typed callback, called with its real type by typed_call
+    void (*typed_function)() = NULL;
+    void (*typed_call)(void (*function)(), Channel_value value) = NULL;
+
+    // Filters of the typed channels, the value is compared to the last notified one
+    float deadband = 0;
+    float hysteresis = 0;
+    unsigned long min_interval = 0;
+    unsigned long last_notify = 0;
+    signed char last_direction = 0;
+    // A change is held back by min_interval, notified by handle() once it has elapsed
+    bool held = false;
+    unsigned long topic_hash;
+
+    // Poll scheduling (a period of 0 poll the channel on every handle)
+    unsigned long poll_period;
+    unsigned long next_poll;
 
     // Constructor
     Channel(String topic_path, void (*function)(String data), String state = String("default value"));
 
-    // Alloc memory to add a new channel to the pointer
-    static Channel deep_copy(Channel chennl_to_copy);
-    static Channel *push_channel_to_array(Channel *old_ptr, Channel channel_to_push, unsigned short new_size);
+    static unsigned long hash_topic(const String &topic);
+
+    // Parse the state with the channel type, false if it is not a valid value
+    bool parse_value(const char *state, Channel_value *value) const;
+    bool is_same_value(Channel_value value) const;
+    // Keep the value and return true if the callback must be called (changed and not filtered)
+    bool accept_value(Channel_value value);
+
+    // Value type and value of the typed callbacks arguments
+    static inline Value_type type_of(const int *) { return INT_VALUE; }
+    static inline Value_type type_of(const long *) { return INT_VALUE; }
+    static inline Value_type type_of(const float *) { return FLOAT_VALUE; }
+    static inline Value_type type_of(const bool *) { return BOOL_VALUE; }
+    static inline void get_value(Channel_value value, int *result) { *result = value.integer; }
+    static inline void get_value(Channel_value value, long *result) { *result = value.integer; }
+    static inline void get_value(Channel_value value, float *result) { *result = value.real; }
+    static inline void get_value(Channel_value value, bool *result) { *result = value.boolean; }
+};
+
+// Channels storage: geometric growth, in place construction and hash index on the topics
+class Channel_registry
+{
+private:
+    Channel *channels = NULL;
+    unsigned short nb_channels = 0;
+    unsigned short capacity = 0;
+
+    // Open addressing index, a slot contains the channel index + 1 (0 is a free slot)
+    unsigned short *index_table = NULL;
+    unsigned short index_size = 0;
+
+    // False if the memory can't be allocated, the old tables are kept
+    bool grow(unsigned short new_capacity);
+    int find_slot(const String &topic_path, unsigned long hash);
+    unsigned short find_free_slot(unsigned long hash);
+    void erase_slot(unsigned short slot);
+
+public:
+    // Incremented on every add / remove
+    unsigned long version = 0;
+
+    // Destructor
+    ~Channel_registry();
+
+    bool reserve(unsigned short capacity);
+
+    // Add a channel (NULL if the registry can't grow), if the topic is already subscribed only the callback function is updated
+    Channel *add(String topic_path, void (*function)(String data), String state = String("default value"));
+    // Remove a channel in O(1), the last channel takes its place
+    bool remove(String topic_path);
+    Channel *find(const String &topic_path);
+
+    inline unsigned short size() { return this->nb_channels; }
+    inline Channel &operator[](unsigned short index) { return this->channels[index]; }
+};
+
+// Min-heap of the channels ordered by their next poll time
+class Poll_scheduler
+{
+private:
+    unsigned short *heap = NULL;
+    unsigned short heap_size = 0;
+    unsigned short capacity = 0;
+    unsigned long version = 0;
+    bool dirty = true;
+
+    bool before(Channel_registry *channels, unsigned short a, unsigned short b);
+    void swap(unsigned short a, unsigned short b);
+    void sift_up(Channel_registry *channels, unsigned short position);
+    void sift_down(Channel_registry *channels, unsigned short position);
+    void push(Channel_registry *channels, unsigned short index);
+
+public:
+    // Destructor
+    ~Poll_scheduler();
+
+    void reserve(unsigned short capacity);
+    // Rebuild the heap if the channels have changed
+    void update(Channel_registry *channels);
+    inline void invalidate() { this->dirty = true; }
+
+    // Fill due_indexes with the channels to poll now and schedule their next poll, return their count
+    // (a failed poll makes its channels due again and invalidates the heap)
+    unsigned short pop_due(Channel_registry *channels, unsigned long now, unsigned short *due_indexes);
+};
+#pragma endregion
+
+#pragma region Write_queue
+struct Pending_write
+{
+    String topic_path;
+    String state;
+    unsigned long topic_hash;
+};
+
+// Buffered writes, a newer value for the same topic replace the older one
+class Write_queue
+{
+private:
+    Pending_write *writes = NULL;
+    unsigned short nb_writes = 0;
+    unsigned short capacity = 0;
+
+    int find(const String &topic_path, unsigned long hash);
+
+public:
+    // Destructor
+    ~Write_queue();
+
+    void reserve(unsigned short capacity);
+    // Return false if the write can't be queued (static memory mode: queue full or too long topic or state)
+    bool push(const String &topic_path, const String &state);
+    // Append the pending writes as "write" tasks
+    void add_tasks(JsonArray tasks);
+    // Exchange the content of the two queues
+    void swap(Write_queue *other);
+    // Put back the writes of an older queue, except the topics written since
+    void restore(Write_queue *older);
+    // Remove the nb_writes first (sent) writes
+    void erase_front(unsigned short nb_writes);
+    // Remove the pending write of the topic, return false if there is none
+    bool remove(const String &topic_path);
+    void clear();
+
+    inline unsigned short size() { return this->nb_writes; }
+    inline Pending_write &operator[](unsigned short index) { return this->writes[index]; }
+};
+#pragma endregion
+
+#pragma region Write_filters
+struct Write_filter
+{
+    String topic_path;
+    unsigned long topic_hash;
+    float deadband;
+    unsigned long max_age;
+
+    // Last sent value
+    float value;
+    unsigned long written_at;
+    bool written;
+};
+
+// Numeric writes: a value is sent only if it moves more than the deadband from the last sent one,
+// or if the last sent one is older than max_age
+class Write_filters
+{
+private:
+    Write_filter *filters = NULL;
+    unsigned short nb_filters = 0;
+    unsigned short capacity = 0;
+
+public:
+    // Destructor
+    ~Write_filters();
+
+    void set(const String &topic_path, float deadband, unsigned long max_age);
+    // NULL if the topic has no filter
+    Write_filter *find(const String &topic_path);
+    // Return false if the value doesn't need to be sent
+    bool accept(Write_filter *filter, float value);
+    void written(Write_filter *filter, float value);
+};
+#pragma endregion
+
+#pragma region Transport
+// Read (and write) a String as a Stream
+class String_stream : public Stream
+{
+private:
+    String *string = NULL;
+    unsigned int position = 0;
+
+public:
+    void set_string(String *string);
+
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t c);
+    using Print::write;
+};
+
+// Incremental HTTP/1.1 response parser (content-length, chunked or closed body)
+class Http_response_parser
+{
+private:
+    enum Parser_state
+    {
+        HEADERS,
+        BODY_LENGTH,
+        BODY_CLOSE,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_END,
+        CHUNK_TRAILER,
+        DONE
+    };
+
+    Parser_state state = HEADERS;
+    String line;
+    unsigned long remaining = (unsigned long)-1;
+    bool chunked = false;
+
+    void parse_header_line();
+    void end_headers();
+
+public:
+    // Attributes
+    int http_code = 0;
+    bool keep_alive = true;
+    String etag;
+    String content_type;
+    String body;
+
+    void reset();
+    // Consume the received bytes, return true when the response is complete
+    bool feed(const char *data, size_t length);
+    // The connection is closed, return true if it completes the response
+    bool finish();
+
+    inline bool is_done() { return this->state == DONE; }
+};
+
+// Low level layer used by Server_Manager to send the requests
+// get and post return the http code (negative value if the request can't be sent)
+class Transport
+{
+protected:
+    // Buffered response used by the default post_stream and start_post
+    String stream_buffer;
+    String_stream buffer_stream;
+    int async_http_code = 0;
+
+    // Raw HTTP/1.1 request (get if request is NULL)
+    String make_raw_request(String method, String host, String path, const String *request, bool keep_alive);
+
+    // Server-Sent Events stream: received bytes (without the carriage returns) and status
+    String events_buffer;
+    int events_http_code = 0;
+    unsigned long events_last_read = 0;
+    String make_events_request(String host, String path);
+    void start_events();
+    bool next_event(String *data);
+    // Non-blocking read of the event stream: number of bytes read (0 if none), negative value if it is closed
+    virtual int read_events(char * /* buffer */, int /* size */) { return -1; }
+
+public:
+    // Connections and bytes counters
+    unsigned long nb_reused_connections = 0;
+    unsigned long nb_new_connections = 0;
+    unsigned long nb_bytes_sent = 0;
+    unsigned long nb_bytes_received = 0;
+
+    // Revision sent in the If-None-Match header (empty: not sent) and ETag of the last response
+    String if_none_match;
+    String etag;
+
+    // Time the server can hold the request before answering (long poll), added to the response timeout
+    unsigned long hold_time = 0;
+
+    // Content type of the post requests (also the accepted one) and of the last response
+    String content_type = JSON_CONTENT_TYPE;
+    String response_content_type;
+
+    virtual ~Transport() {}
+
+    virtual int get(const char *uri, String *response) = 0;
+    virtual int post(const char *uri, const String &request, String *response) = 0;
+
+    // Send a post request and give the stream to read the response, end_stream() must be called after the read
+    virtual int post_stream(const char *uri, const String &request, Stream **response_stream);
+    virtual void end_stream();
+
+    // Asynchronous post: start_post() send the request (negative value on error),
+    // poll_response() return FLOKER_PENDING until the response is complete
+    // A transport that sends it on the connection of get / post must complete it in start_post()
+    virtual int start_post(const char *uri, const String &request);
+    virtual int poll_response(String *response);
+
+    // Close the kept connection, the next request will open a new one
+    virtual void close() {}
+
+    // Server-Sent Events stream (push), open_events() return false if the transport doesn't support it
+    virtual bool open_events(const char * /* uri */) { return false; }
+    // Give the data of the next event: 200 if there is one, FLOKER_PENDING if none,
+    // else the stream is closed (FLOKER_EVENTS_CLOSED or the HTTP error code)
+    int poll_event(String *data);
+    virtual void close_events() {}
+
+    // Change notification datagrams (poke), read_poke() is non-blocking and give the hints of the poke
+    virtual bool begin_poke(unsigned short /* port */) { return false; }
+    virtual bool read_poke(String * /* hints */) { return false; }
+
+    static void split_uri(const char *uri, String *host, String *port, String *path);
+
+    virtual String error_to_string(int http_code) { return String(http_code); }
+    virtual bool need_wifi() { return true; }
+};
+
+#ifdef FLOKER_WIFI_ENABLED
+class Http_transport : public Transport
+{
+private:
+    // WiFi and HTTP client object
+    WiFiClient wifi_client;
+    HTTPClient http_client;
+
+    bool keep_alive;
+
+    // Asynchronous request, on its own connection: the direct requests can be sent while it is in flight
+    WiFiClient async_client;
+    Http_response_parser parser;
+    unsigned long async_start = 0;
+    unsigned long async_timeout = 0;
+
+    // Event stream connection
+    WiFiClient events_client;
+    int read_events(char *buffer, int size);
+
+    // Poke listener
+    WiFiUDP poke_udp;
+
+    // Send a get request if request is NULL else a post one, the response is not read
+    int open_request(const char *uri, const String *request);
+    int send_request(const char *uri, const String *request);
+    int read_response(int http_code, String *response);
+
+public:
+    // Constructor
+    Http_transport(bool keep_alive = true);
+
+    int get(const char *uri, String *response);
+    int post(const char *uri, const String &request, String *response);
+    int post_stream(const char *uri, const String &request, Stream **response_stream);
+    void end_stream();
+    int start_post(const char *uri, const String &request);
+    int poll_response(String *response);
+    void close();
+
+    bool open_events(const char *uri);
+    void close_events();
+
+    bool begin_poke(unsigned short port);
+    bool read_poke(String *hints);
+
+    String error_to_string(int http_code) { return this->http_client.errorToString(http_code); }
+};
+#endif
+
+#ifdef HOST_ENABLED
+class Posix_transport : public Transport
+{
+private:
+    // Kept connection
+    int socket_fd = -1;
+    String host;
+    String port;
+
+    Http_response_parser parser;
+
+    // Event stream connection
+    int events_fd = -1;
+    int read_events(char *buffer, int size);
+
+    // Poke listener
+    int poke_fd = -1;
+
+    static int connect_socket(String host, String port);
+    bool open_connection(String host, String port);
+    int read_response(String *response);
+    int send_request(String method, const char *uri, const String *request, String *response);
+
+public:
+    // Attributes
+    bool keep_alive = true;
+
+    // Destructor
+    ~Posix_transport();
+
+    int get(const char *uri, String *response);
+    int post(const char *uri, const String &request, String *response);
+    void close();
+
+    bool open_events(const char *uri);
+    void close_events();
+
+    bool begin_poke(unsigned short port);
+    bool read_poke(String *hints);
+    // Local test sender: poke a device listening on host:port
+    static bool send_poke(String host, unsigned short port, String hints = String(""));
+
+    String error_to_string(int http_code);
+    bool need_wifi() { return false; }
+};
+#endif
+
+// In-process server speaking the read? / write? / multi? protocol, used to test and benchmark the library
+struct Mock_topic
+{
+    String topic;
+    String state;
+    unsigned long revision;
+};
+
+// Server side change applied at a given time
+struct Mock_change
+{
+    String topic;
+    String state;
+    unsigned long at;
+};
+
+class Mock_transport : public Transport
+{
+private:
+    String token;
+
+    // Topics store, the revision is incremented on every state change
+    Mock_topic *topics = NULL;
+    unsigned long revision = 0;
+    unsigned short nb_topics = 0;
+    unsigned short topics_capacity = 0;
+
+    // Registered read tasks, the subscription id is 's' + the index
+    String *subscriptions = NULL;
+    unsigned short nb_subscriptions = 0;
+    unsigned short subscriptions_capacity = 0;
+
+    // Scheduled changes, a held long poll wakes up on them
+    Mock_change *changes = NULL;
+    unsigned short nb_changes = 0;
+    unsigned short changes_capacity = 0;
+
+    // Event stream of a subscription, the changes after events_revision are not sent yet
+    bool events_open = false;
+    unsigned short events_subscription = 0;
+    unsigned long events_revision = 0;
+    unsigned long events_ping = 0;
+    String events_output;
+    int read_events(char *buffer, int size);
+
+    // Received pokes, coalesced until read
+    bool poked = false;
+    String poke_hints;
+
+    // Tools
+    int find_topic(String topic);
+    static String get_parameter(const char *uri, String name);
+    static String get_endpoint(String uri);
+    String read_task(String topic, int *http_code);
+    String write_task(String topic, String state, int *http_code);
+    void run_tasks(JsonArray tasks, JsonArray responses, bool keyed, unsigned long client_revision, unsigned short *index);
+    int multi_task(String request, String *response, bool delta, String subscription_id, unsigned long wait);
+    int subscribe_task(String request, String *response);
+    void apply_changes();
+    bool has_changed(JsonArray tasks);
+    bool hold(JsonArray tasks, unsigned long wait);
+
+public:
+    // Attributes
+    int failure_code = 0;
+    bool msgpack_supported = true;
+    unsigned long nb_get_requests = 0;
+    unsigned long nb_post_requests = 0;
+
+    // Constructor
+    Mock_transport(String token = String(""));
+    // Destructor
+    ~Mock_transport();
+
+    // Server side access to the topics
+    void set_state(String topic, String state);
+    bool get_state(String topic, String *state);
+    // Apply the change after change_delay ms (on the next request or during a held long poll)
+    void schedule_state(String topic, String state, unsigned long change_delay);
+
+    int get(const char *uri, String *response);
+    int post(const char *uri, const String &request, String *response);
+
+    // The changes of the subscription topics are streamed, close_events() simulates a drop of the stream
+    bool open_events(const char *uri);
+    void close_events();
+
+    // Server side poke (hints: comma separated topics, empty: all the topics)
+    void send_poke(String hints = String(""));
+    bool begin_poke(unsigned short /* port */) { return true; }
+    bool read_poke(String *hints);
+
+    bool need_wifi() { return false; }
+};
+#pragma endregion
+
+#pragma region Retry
+// Retry of the force writes by handle(): exponential backoff with jitter, limited in attempts and time
+class Retry_policy
+{
+public:
+    // Attributes
+    unsigned short max_attempts;
+    unsigned long base_delay;
+    unsigned long max_delay;
+    unsigned long deadline;
+
+    // Constructor
+    Retry_policy(
+        unsigned short max_attempts = DEFAULT_RETRY_MAX_ATTEMPTS,
+        unsigned long base_delay = DEFAULT_RETRY_BASE_DELAY,
+        unsigned long max_delay = DEFAULT_RETRY_MAX_DELAY,
+        unsigned long deadline = DEFAULT_RETRY_DEADLINE);
+
+    // Delay to wait before the next attempt (attempt start at 1)
+    unsigned long get_delay(unsigned short attempt);
+};
+
+// Skip the requests while the server is known to be down, probe it again every open_interval
+class Circuit_breaker
+{
+private:
+    unsigned short nb_failures = 0;
+    bool open = false;
+    unsigned long opened_at = 0;
+
+public:
+    // Attributes (a failure_threshold of 0 disable the breaker)
+    unsigned short failure_threshold;
+    unsigned long open_interval;
+
+    // Constructor
+    Circuit_breaker(
+        unsigned short failure_threshold = DEFAULT_BREAKER_FAILURE_THRESHOLD,
+        unsigned long open_interval = DEFAULT_BREAKER_OPEN_INTERVAL);
+
+    bool allow_request();
+    void on_success();
+    void on_failure();
+
+    inline bool is_open() { return this->open; }
+};
+#pragma endregion
+
+#pragma region Metrics
+// Counters and gauges of the library
+class Metrics
+{
+public:
+    enum Request_type
+    {
+        READ_REQUEST,
+        WRITE_REQUEST,
+        MULTI_REQUEST,
+        SUBSCRIBE_REQUEST,
+        EVENTS_REQUEST,
+        NB_REQUEST_TYPES
+    };
+
+    // Requests (a retry is counted as a request)
+    unsigned long nb_requests[NB_REQUEST_TYPES];
+    unsigned long nb_failures = 0;
+    unsigned long nb_retries = 0;
+    unsigned long nb_bytes_sent = 0;
+    unsigned long nb_bytes_received = 0;
+
+    // Round trip latency (ms)
+    unsigned long latency_min = 0;
+    unsigned long latency_max = 0;
+    unsigned long latency_sum = 0;
+    unsigned long nb_latencies = 0;
+    unsigned long latency_histogram[NB_LATENCY_BUCKETS];
+
+    unsigned long nb_callbacks = 0;
+    // Changes dropped by the deadband or the hysteresis (not the ones held back by min_interval) and writes dropped by the write filters
+    unsigned long nb_filtered_callbacks = 0;
+    unsigned long nb_filtered_writes = 0;
+
+    // Heap before and after the last handle() (0 on host)
+    unsigned long free_heap_before = 0;
+    unsigned long free_heap_after = 0;
+    unsigned long largest_block_before = 0;
+    unsigned long largest_block_after = 0;
+    unsigned long min_free_heap = 0;
+
+    // Constructor
+    Metrics();
+
+    void record_request(Request_type type, bool success, unsigned long latency);
+    void record_heap(bool after_handle);
+    inline unsigned long get_latency_avg() { return (this->nb_latencies == 0) ? 0 : this->latency_sum / this->nb_latencies; }
+
+    // Compact JSON of all the metrics
+    String to_json();
+    // Same, built in the given document (false if it doesn't fit)
+    bool to_json(JsonDocument &json_metrics, String *metrics);
+
+    static unsigned long get_free_heap();
+    static unsigned long get_largest_block();
+};
+#pragma endregion
+
+#pragma region Uri
+// URI written in a fixed buffer without heap allocation: the constant prefix (scheme, host, port and root path)
+// is kept and each URI appends its endpoint and percent-encoded parameters
+class Uri_builder
+{
+private:
+    char buffer[DEFAULT_URI_SIZE];
+    unsigned short prefix_length = 0;
+    unsigned short length = 0;
+    bool overflow = false;
+
+    void append_char(char c);
+    void append_number(unsigned long number);
+
+public:
+    // Constructor
+    Uri_builder();
+
+    void set_prefix(const char *scheme, const char *host, unsigned short port, const char *root_path);
+    // Restart from the prefix with the given endpoint
+    void start(const char *endpoint);
+    // Append "?name=" (first parameter) or "&name=" and the encoded value
+    void add_parameter(const char *name, const char *value);
+    void add_parameter(const char *name, unsigned long value);
+    void append(const char *text);
+    void append_encoded(const char *text);
+
+    inline const char *c_str() { return this->buffer; }
+    inline unsigned short size() { return this->length; }
+    // The URI didn't fit in the buffer, it is truncated and must not be sent
+    inline bool is_overflow() { return this->overflow; }
+
+    // Unreserved characters (and '/' for the topic paths) are kept, the others are written %XX
+    static bool is_unreserved(char c);
 };
 #pragma endregion
 
@@ -84,19 +977,59 @@ private:
     String root_path;
     String token;
 
-    // WiFi and HTTP client object
-    WiFiClient wifi_client;
-    HTTPClient http_client;
+    // Requests transport
+    Transport *transport_ptr = NULL;
+    bool own_transport = true;
+
+    // WiFi connection state machine
+    unsigned long connection_state_time = 0;
+#ifdef FLOKER_WIFI_ENABLED
+    void start_wifi();
+#endif
 
     // Tools
-    inline String start_url() { return this->request_type + this->server + String(":") + String(this->port) + this->root_path; }
-    String make_uri(String topic = String(""), String data_to_write = String(""));
-    bool get_request(String uri, String *response, bool force_request = false);
-    bool post_request(String uri, String request, String *response, bool force_request = false);
+    // Reused URI buffer, the prefix is rebuilt when the port changes
+    Uri_builder uri;
+    unsigned short uri_port = 0;
+    void make_uri(const char *endpoint);
+    const char *prepare_multi_request(const String *revision, const String *subscription_id, unsigned long hold_time);
+    bool send_request(Metrics::Request_type type, const char *uri, const String *request, String *response, Stream **response_stream = NULL);
+    bool get_request(Metrics::Request_type type, const char *uri, String *response);
+    bool post_request(Metrics::Request_type type, const char *uri, const String &request, String *response);
+    // Write task in the body of a multi request, for the states too large for the URI
+    bool write_in_body(const String &topic_path, const String &data_to_write);
+
+    // Start time of the asynchronous request
+    unsigned long async_request_start = 0;
+
+    // MessagePack encoding of the multi requests, the last encoded request is kept
+    String json_request_cache;
+    String msgpack_request_cache;
+    // Give the request itself or its cached MessagePack encoding
+    const String &encode_multi_request(const String &request);
+    void check_msgpack_support();
 
 public:
+    enum Connection_state
+    {
+        DISCONNECTED,
+        CONNECTING,
+        CONNECTED
+    };
+
     // Attributes
     String device_type = FLOKER_DEVICE_TYPE;
+    Connection_state connection_state = DISCONNECTED;
+    // Incremented on every established connection
+    unsigned long nb_connections = 0;
+    // 0 if the last request was not sent (not connected, circuit breaker open), 414 if its URI was too long
+    int last_http_code = 0;
+    Retry_policy retry_policy;
+    Circuit_breaker circuit_breaker;
+    // Send the multi requests in compact MessagePack (disabled if the server answers 415)
+    bool enable_msgpack = false;
+    bool msgpack_supported = true;
+    Metrics metrics;
     String ip;
     unsigned short port;
 
@@ -113,14 +1046,60 @@ public:
         String root_path,
         String token,
         String device_path = String(""));
+    // Destructor
+    ~Server_Manager();
+
+    // Replace the default transport (the given one is not freed by the Server_Manager)
+    void set_transport(Transport *transport_ptr);
+
+    // Metrics with the bytes counters of the transport
+    Metrics *get_metrics();
+
+    // The last multi response is compact MessagePack (else JSON)
+    inline bool is_msgpack_response() { return strncmp(this->transport_ptr->response_content_type.c_str(), MSGPACK_CONTENT_TYPE, strlen(MSGPACK_CONTENT_TYPE)) == 0; }
 
-    // Start the server connection
+    // Connection reuse counters
+    inline unsigned long get_reused_connections() { return this->transport_ptr->nb_reused_connections; }
+    inline unsigned long get_new_connections() { return this->transport_ptr->nb_new_connections; }
+
+    // Start the server connection (non-blocking)
     void begin();
+    // Advance the connection and reconnect if it is lost, return true if connected
+    bool handle_connection();
+    inline bool is_connected() { return this->connection_state == CONNECTED; }
 
     // Interact with the server
-    bool read(String topic_path, String *get_data, bool force = false);
-    bool write(String topic_path, String data_to_write, bool force = false);
-    bool multi_tasks(String request, String *response, bool force = false);
+    // A single attempt, the forced writes are retried by Floker::handle()
+    bool read(const String &topic_path, String *get_data);
+    bool write(const String &topic_path, const String &data_to_write);
+    bool multi_tasks(String request, String *response);
+    // The response is read from the stream, end_stream() must be called after the read
+    // With a revision, only the changed topics are returned (304 if nothing changed), the new one is get_etag()
+    // With a subscription id, the registered read tasks are executed and the responses are keyed by index
+    // With a hold time (long poll), the server answers when a read state differs from the sent one (304 on timeout)
+    bool multi_tasks_stream(
+        const String &request,
+        Stream **response_stream,
+        const String *revision = NULL,
+        const String *subscription_id = NULL,
+        unsigned long hold_time = 0);
+    // Asynchronous multi request: poll_multi_tasks() return FLOKER_PENDING until the response is complete
+    bool start_multi_tasks(const String &request, const String *revision = NULL, const String *subscription_id = NULL, unsigned long hold_time = 0);
+    int poll_multi_tasks(String *response);
+    // Revision (ETag) of the last response
+    inline const String &get_etag() { return this->transport_ptr->etag; }
+    // Register read tasks, the response contains the subscription id
+    bool subscribe(String request, String *response);
+    void end_stream();
+
+    // Event stream of the changes of a subscription, see Transport::poll_event()
+    bool open_events(String subscription_id);
+    inline int poll_event(String *data) { return this->transport_ptr->poll_event(data); }
+    inline void close_events() { this->transport_ptr->close_events(); }
+
+    // Change notification datagrams, see Transport::read_poke()
+    inline bool begin_poke(unsigned short port) { return this->transport_ptr->begin_poke(port); }
+    inline bool read_poke(String *hints) { return this->transport_ptr->read_poke(hints); }
 };
 #pragma endregion
 
@@ -129,9 +1108,14 @@ class Software_polling
 {
 private:
     // Connected polling and static information
-    bool static_information_pushed = false;
+    unsigned long static_information_connection = 0;
     unsigned long last_connection_update = 0;
 
+    // Metrics publishing (interval 0: disabled)
+    String metrics_topic_path;
+    unsigned long metrics_interval = 0;
+    unsigned long last_metrics_update = 0;
+
     String connection_state_topic_path;
     String connection_interval_topic_path;
     String connection_type_topic_path;
@@ -151,8 +1135,11 @@ public:
         String type_topic_path,
         String version_topic_path,
         String ip_topic_path);
-    Channel create_interval_channel();
-    void handle(Server_Manager *server_ptr);
+    void subscribe_interval_channel(Channel_registry *channels);
+    void set_metrics_publishing(String metrics_topic_path, unsigned long interval);
+    inline bool is_publishing_metrics() { return this->metrics_interval != 0; }
+    // Queue the heartbeat, the static information and the metrics (built in the JSON arena), they are sent with the channels request
+    void handle(Server_Manager *server_ptr, Write_queue *write_queue, JsonDocument *json_arena);
 };
 #pragma endregion
 
@@ -162,8 +1149,13 @@ class Floker
 private:
     // Tools pointers
     Server_Manager *server_ptr;
-    Channel *channels_ptr;
-    Software_polling *software_polling_ptr;
+    Software_polling *software_polling_ptr = NULL;
+
+    // Base path of the connection polling topics
+    String connection_polling_path;
+
+    // Subscribed channels
+    Channel_registry channels;
 
     // Attributes
     bool enable_software_polling = false;
@@ -174,14 +1166,173 @@ private:
     // Handle functions
     bool enable_multi_handle = true;
 
+    // Serialized multi request, rebuilt only when the subscribed channels change
+    String multi_request_body;
+    unsigned long multi_request_version = 0;
+
+    // Buffers reused by the handle cycles: the sent request, its write tasks, the response
+    // and the text of the non-string response values
+    String multi_request;
+    String write_tasks;
+    String response;
+    String response_text;
+    // Previous state of the updated channel, swapped out before its callback
+    String previous_state;
+    void reserve_buffers();
+
+    // Buffered writes, flushed with the next multi request
+    bool enable_buffered_write = false;
+    Write_queue write_queue;
+    Write_filters write_filters;
+    void append_write_tasks(String *request);
+    void flush_write_queue();
+
+    // Failed force writes, retried by handle() with the retry policy (the writes share the attempts)
+    Write_queue retry_queue;
+    unsigned short retry_attempt = 0;
+    unsigned long retry_start = 0;
+    unsigned long retry_time = 0;
+    unsigned long retry_delay = 0;
+    void schedule_retry(const String &topic_path, const String &state);
+    void retry_writes_handle();
+
+    // Subscription mode: the channels are registered once on the server
+    bool enable_subscription = false;
+    bool subscription_supported = true;
+    String subscription_id;
+    unsigned long subscription_version = 0;
+    bool register_subscription();
+
+    // Delta polling: revision (ETag) of the last multi response, only kept once the response is fully dispatched
+    bool enable_delta_polling = false;
+    String multi_revision;
+    String response_revision;
+    // The next delta poll gets all the states
+    void reset_revision();
+    void build_multi_request_body();
+    bool multi_tasks(String request, DynamicJsonDocument *response);
+
+    // Compare the new state and execute the callback function if it has changed
+    // The channel is updated before the callback: it can subscribe / unsubscribe (the channel can move)
+    void update_channel(Channel *channel, const char *state);
+    void update_typed_channel(Channel *channel, const char *state);
+    // Earliest end of the min_interval of the held back channels
+    bool held_pending = false;
+    unsigned long held_release = 0;
+    void release_held_channels();
+    Channel *add_channel(String topic_path, bool autocomplete_topic, unsigned long poll_period);
+
+    // Call the member function or the callable given as context (no std::function allocation)
+    template <class T, void (T::*method)(const Channel &, State_view, State_view)>
+    static void call_method(void *object, const Channel &channel, State_view state, State_view old_state)
+    {
+        (static_cast<T *>(object)->*method)(channel, state, old_state);
+    }
+    template <class F>
+    static void call_callable(void *callable, const Channel &channel, State_view state, State_view old_state)
+    {
+        (*static_cast<F *>(callable))(channel, state, old_state);
+    }
+
+    // Typed channels: call the callback with its real type
+    Channel *subscribe_typed(String topic_path, Channel::Value_type type, void (*function)(), void (*call)(void (*function)(), Channel_value value), bool autocomplete_topic, unsigned long poll_period);
+    template <class T>
+    static void call_typed(void (*function)(), Channel_value value)
+    {
+        T typed_value;
+        Channel::get_value(value, &typed_value);
+        reinterpret_cast<void (*)(T)>(function)(typed_value);
+    }
+    template <class E>
+    static void call_enum(void (*function)(), Channel_value value)
+    {
+        reinterpret_cast<void (*)(E)>(function)(static_cast<E>(value.integer));
+    }
+
+    // JSON arena: one document for all the request and response JSON work of the cycles,
+    // sized from the channels at begin(), cleared every cycle and only grown when they need more
+    // (fixed size in static memory mode)
+#ifdef FLOKER_STATIC_MEMORY
+    StaticJsonDocument<FLOKER_JSON_ARENA_SIZE> json_arena_document;
+#else
+    DynamicJsonDocument *json_arena_document = NULL;
+    size_t get_json_arena_size();
+#endif
+    JsonDocument *json_arena = NULL;
+    bool json_arena_overflow = false;
+    void reset_json_arena();
+    bool check_json_arena();
+
+    // Due channels of the current request (batch_full: all the channels in the registry order)
+    Poll_scheduler scheduler;
+    unsigned short *batch_indexes = NULL;
+    unsigned short batch_capacity = 0;
+    unsigned short batch_size = 0;
+    unsigned long batch_version = 0;
+    bool batch_full = true;
+    // Writes only cycle: the batch is empty, the due channels are not read
+    bool writes_only = false;
+    unsigned short schedule_batch();
+    inline Channel *batch_channel(unsigned short k) { return &this->channels[this->batch_full ? k : this->batch_indexes[k]]; }
+    // The batch was not polled (failed or not sent request): its channels are due again on the next cycle
+    void retry_batch();
+    void build_batch_body(String *request, bool with_states = false);
+
+    // Long poll: the server holds the multi request until a state changes
+    bool enable_long_poll = false;
+    unsigned long long_poll_timeout = DEFAULT_LONG_POLL_TIMEOUT;
+    unsigned long get_hold_time();
+    bool use_revision();
+
+    // Multi request steps
+    bool prepare_multi_request(String *request, bool *subscribed);
+    // sent_writes: the buffered writes of the failed request, dropped if the server refused it (4xx)
+    void multi_request_failed(bool subscribed, Write_queue *sent_writes);
+    // Return true if all the under responses are dispatched (else the revision is not kept)
+    bool dispatch_multi_response(Stream *response_stream);
+    bool dispatch_msgpack_response(Stream *response_stream);
+    void dispatch_under_response(unsigned short index, const char *data);
+
+    // Asynchronous handle: at most one multi request in flight
+    bool enable_async_handle = false;
+    bool async_request_pending = false;
+    bool async_subscribed = false;
+    bool async_revision = false;
+    Write_queue in_flight_writes;
+
+    // Push: the changes are received on an event stream, the channels are polled while it is closed
+    bool enable_push = false;
+    bool push_connected = false;
+    bool push_resync = false;
+    unsigned long push_version = 0;
+    unsigned long push_retry_time = 0;
+    bool open_push();
+    void close_push();
+    void resync_channels();
+    void dispatch_event(String data);
+    void push_channels_handle();
+
+    // Poke: the channels are polled when the server pokes them, else at a slow background interval
+    bool enable_poke = false;
+    bool poke_started = false;
+    bool poke_pending = false;
+    unsigned short poke_port = DEFAULT_POKE_PORT;
+    unsigned long poke_background_interval = DEFAULT_POKE_BACKGROUND_INTERVAL;
+    unsigned long poke_poll_time = 0;
+    void poke_channels(String hints, bool all_channels);
+    void poke_channels_handle();
+
     void subscribed_channels_handle();
+    // Send the queued writes (or advance the request in flight) without polling the channels
+    void write_channels_handle();
     void classic_subscribed_channels_handle();
     void multi_subscribed_channels_handle();
+    void async_multi_subscribed_channels_handle();
 
-public:
-    // Attributes
-    unsigned short nb_channels = 0;
+    // Called by begin() with the configuration symbol of the calling file
+    void start(const unsigned char *config);
 
+public:
     // Constructor
     Floker(const char *ssid,
            const char *password,
@@ -190,12 +1341,71 @@ public:
            String root_path,
            String token,
            String device_path = String(""));
+    // Destructor
+    ~Floker();
 
     // Class properties
     void set_port(unsigned short port);
 
     void set_multi_handle(bool enable_multi_handle);
 
+    // handle() doesn't wait for the response: the multi request is advanced on each call
+    // The direct read() / write() calls are still allowed, they use another connection
+    void set_async_handle(bool enable_async_handle);
+
+    // Queue the writes (not forced) and send them in the next handle() multi request
+    void set_buffered_write(bool enable_buffered_write);
+
+    // Register the channels once on the server and only send the subscription id on each poll
+    // (fall back to the full requests if the server doesn't support it)
+    void set_subscription(bool enable_subscription);
+
+    // Only get the channels changed since the last multi poll (the server must support it)
+    void set_delta_polling(bool enable_delta_polling);
+
+    // Send the known states and let the server hold the multi request until one changes or the timeout
+    // (the synchronous handle waits for the response, use it with the asynchronous handle)
+    void set_long_poll(bool enable_long_poll, unsigned long timeout = DEFAULT_LONG_POLL_TIMEOUT);
+
+    // Receive the changes of the subscribed channels on a Server-Sent Events stream,
+    // poll them while the stream is closed and resync them when it is back
+    void set_push(bool enable_push);
+
+    // Send the multi requests in compact MessagePack, JSON is kept if the server doesn't support it
+    void set_msgpack(bool enable_msgpack);
+
+    // Poll the channels when a UDP datagram from the server pokes them (it can carry a comma separated topics list),
+    // else every background_interval (the channels are polled on each handle() if the port can't be opened)
+    void set_poke(
+        bool enable_poke,
+        unsigned short port = DEFAULT_POKE_PORT,
+        unsigned long background_interval = DEFAULT_POKE_BACKGROUND_INTERVAL);
+
+    void set_transport(Transport *transport_ptr);
+
+    // Force writes retry (from handle(), without blocking) and server outage handling
+    void set_retry_policy(
+        unsigned short max_attempts = DEFAULT_RETRY_MAX_ATTEMPTS,
+        unsigned long base_delay = DEFAULT_RETRY_BASE_DELAY,
+        unsigned long max_delay = DEFAULT_RETRY_MAX_DELAY,
+        unsigned long deadline = DEFAULT_RETRY_DEADLINE);
+    void set_circuit_breaker(
+        unsigned short failure_threshold = DEFAULT_BREAKER_FAILURE_THRESHOLD,
+        unsigned long open_interval = DEFAULT_BREAKER_OPEN_INTERVAL);
+
+    // Log output (NULL: Serial) and rate limit (at most max_messages every interval, 0: no limit)
+    inline void set_log_sink(Floker_log_sink sink) { Floker_log::set_sink(sink); }
+    inline void set_log_rate_limit(unsigned short max_messages, unsigned long interval) { Floker_log::set_rate_limit(max_messages, interval); }
+
+    // Requests, latency, callbacks and heap metrics
+    inline Metrics *get_metrics() { return this->server_ptr->get_metrics(); }
+    // Publish the metrics as one batched write every interval (after set_connection_polling())
+    void set_metrics_publishing(unsigned long interval = DEFAULT_METRICS_INTERVAL, String metrics_path = DEFAULT_METRICS_POLLING_PATH);
+
+    // Connection reuse counters (keep-alive)
+    inline unsigned long get_reused_connections() { return this->server_ptr->get_reused_connections(); }
+    inline unsigned long get_new_connections() { return this->server_ptr->get_new_connections(); }
+
     // Set the polling connection(connected state and static information)
     void set_connection_polling(
         String no_default_device_path = String(""),
@@ -208,14 +1418,74 @@ public:
         String state_ip_path = DEFAULT_IP_POLLING_PATH);
 
     // Methods
-    void begin();
+    // Compiled in the calling file to check its configuration flags (FLOKER_CONFIG_SYMBOL)
+    inline void begin() { this->start(&FLOKER_CONFIG_SYMBOL); }
     void handle();
+    inline bool is_connected() { return this->server_ptr->is_connected(); }
 
     // Interact with the high level interaction with the server
-    void subscribe(String topic_path, void (*function)(String data), bool autocomplete_topic = true);
+    // poll_period: minimum time between two polls of the channel (0: every handle)
+    void subscribe(String topic_path, void (*function)(String data), bool autocomplete_topic = true, unsigned long poll_period = 0);
+    // The callback gets the state in place, without String copy (no allocation in static memory mode)
+    void subscribe(String topic_path, void (*function)(const char *data), bool autocomplete_topic = true, unsigned long poll_period = 0);
+    // The callback gets the context, the channel and views of the new and old states
+    void subscribe(String topic_path, Channel_function function, void *context, bool autocomplete_topic = true, unsigned long poll_period = 0);
+    // Member function: broker.subscribe<Heater, &Heater::on_state>(topic_path, &heater)
+    template <class T, void (T::*method)(const Channel &, State_view, State_view)>
+    void subscribe(String topic_path, T *object, bool autocomplete_topic = true, unsigned long poll_period = 0)
+    {
+        this->subscribe(topic_path, &Floker::call_method<T, method>, object, autocomplete_topic, poll_period);
+    }
+    // Lambda or functor, not copied: it must live as long as the subscription
+    template <class F>
+    void subscribe(String topic_path, F *callable, bool autocomplete_topic = true, unsigned long poll_period = 0)
+    {
+        this->subscribe(topic_path, &Floker::call_callable<F>, callable, autocomplete_topic, poll_period);
+    }
+    // Typed channel (int, long, float or bool): the callback gets the value, only when it changes
+    template <class T>
+    void subscribe(String topic_path, void (*function)(T value), bool autocomplete_topic = true, unsigned long poll_period = 0)
+    {
+        this->subscribe_typed(topic_path, Channel::type_of((T *)NULL), reinterpret_cast<void (*)()>(function), &Floker::call_typed<T>, autocomplete_topic, poll_period);
+    }
+    // Enum channel: the state is one of the names, the callback gets its index as the enum value
+    template <class E>
+    void subscribe(String topic_path, void (*function)(E value), const char *const *names, unsigned short nb_names, bool autocomplete_topic = true, unsigned long poll_period = 0)
+    {
+        Channel *channel = this->subscribe_typed(topic_path, Channel::ENUM_VALUE, reinterpret_cast<void (*)()>(function), &Floker::call_enum<E>, autocomplete_topic, poll_period);
+        if (channel == NULL)
+            return;
+
+        channel->enum_names = names;
+        channel->nb_enum_names = nb_names;
+    }
+    bool unsubscribe(String topic_path, bool autocomplete_topic = true);
+    // Typed channel filters (after subscribe): the callback is called only if the value moves more than the deadband
+    // from the last notified one, more than the hysteresis when it goes back, and min_interval (ms) after the last call
+    bool set_read_filter(String topic_path, float deadband, float hysteresis = 0, unsigned long min_interval = 0, bool autocomplete_topic = true);
+    inline unsigned short get_nb_channels() { return this->channels.size(); }
 
-    bool read(String topic_path, String *get_data, bool autocomplete_topic = true, bool force_request = false);
+    // The reads and multi tasks are sent once, force_request only applies to the writes: not buffered,
+    // not filtered, and retried by handle() if they fail (false is returned)
+    bool read(String topic_path, String *get_data, bool autocomplete_topic = true);
     bool write(String topic_path, String data_to_write, bool autocomplete_topic = true, bool force_request = false);
-    bool multi_tasks(DynamicJsonDocument request, DynamicJsonDocument *response, bool force_request = false);
+    // Numeric write, filtered if the topic has a write filter
+    bool write_value(String topic_path, float value, unsigned char decimals = 2, bool autocomplete_topic = true, bool force_request = false);
+    // The values of write_value() are sent only if they move more than the deadband from the last sent one,
+    // or if it has been sent more than max_age (ms, 0: never) ago
+    void set_write_filter(String topic_path, float deadband, unsigned long max_age = 0, bool autocomplete_topic = true);
+    bool multi_tasks(DynamicJsonDocument request, DynamicJsonDocument *response);
+
+    // Deprecated: the reads and multi tasks are not retried, force_request has no effect
+    __attribute__((deprecated("force_request has no effect on the reads, use read(topic_path, get_data, autocomplete_topic)")))
+    inline bool read(String topic_path, String *get_data, bool autocomplete_topic, bool /* force_request */)
+    {
+        return this->read(topic_path, get_data, autocomplete_topic);
+    }
+    __attribute__((deprecated("force_request has no effect on the multi tasks, use multi_tasks(request, response)")))
+    inline bool multi_tasks(DynamicJsonDocument request, DynamicJsonDocument *response, bool /* force_request */)
+    {
+        return this->multi_tasks(request, response);
+    }
 };
 #pragma endregion
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+
+#pragma region Time
+static const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield()
+{
+}
+#pragma endregion
+
+#pragma region Random
+void randomSeed(unsigned long seed)
+{
+    if (seed != 0)
+        srand(seed);
+}
+
+long random(long max)
+{
+    return (max <= 0) ? 0 : rand() % max;
+}
+
+long random(long min, long max)
+{
+    return (min >= max) ? min : min + random(max - min);
+}
+#pragma endregion
+
+#pragma region String
+std::string String::from_integer(unsigned long value, unsigned char base, bool negative)
+{
+    if (base < 2 || base > 36)
+        base = 10;
+
+    char digits[8 * sizeof(unsigned long) + 2];
+    char *digit = digits + sizeof(digits) - 1;
+    *digit = '\0';
+    do
+    {
+        unsigned long remainder = value % base;
+        *--digit = (remainder < 10) ? '0' + remainder : 'a' + remainder - 10;
+        value /= base;
+    } while (value != 0);
+    if (negative)
+        *--digit = '-';
+
+    return std::string(digit);
+}
+
+std::string String::from_float(double value, unsigned char decimal_places)
+{
+    if (isnan(value))
+        return "nan";
+    if (isinf(value))
+        return "inf";
+
+    char digits[64];
+    snprintf(digits, sizeof(digits), "%.*f", decimal_places, value);
+    return std::string(digits);
+}
+#pragma endregion
+
+#pragma region Stream
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = this->read();
+        if (c >= 0)
+            return c;
+        yield();
+    } while (millis() - start < this->timeout);
+    return -1;
+}
+
+int Stream::timedPeek()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = this->peek();
+        if (c >= 0)
+            return c;
+        yield();
+    } while (millis() - start < this->timeout);
+    return -1;
+}
+
+bool Stream::findUntil(const char *target, const char *terminator)
+{
+    size_t target_length = strlen(target);
+    size_t terminator_length = (terminator == NULL) ? 0 : strlen(terminator);
+    if (target_length == 0)
+        return true;
+
+    // Matched characters of the target and the terminator
+    size_t nb_target = 0;
+    size_t nb_terminator = 0;
+    int c;
+    while ((c = this->timedRead()) >= 0)
+    {
+        if (c == target[nb_target])
+        {
+            if (++nb_target == target_length)
+                return true;
+        }
+        else
+            nb_target = (c == target[0]) ? 1 : 0;
+
+        if (terminator_length > 0)
+        {
+            if (c == terminator[nb_terminator])
+            {
+                if (++nb_terminator == terminator_length)
+                    return false;
+            }
+            else
+                nb_terminator = (c == terminator[0]) ? 1 : 0;
+        }
+    }
+    return false;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t nb_read = 0;
+    while (nb_read < length)
+    {
+        int c = this->timedRead();
+        if (c < 0)
+            break;
+        buffer[nb_read++] = (char)c;
+    }
+    return nb_read;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+    size_t nb_read = 0;
+    while (nb_read < length)
+    {
+        int c = this->timedRead();
+        if (c < 0 || c == terminator)
+            break;
+        buffer[nb_read++] = (char)c;
+    }
+    return nb_read;
+}
+
+String Stream::readString()
+{
+    String text;
+    int c;
+    while ((c = this->timedRead()) >= 0)
+        text.concat((char)c);
+    return text;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String text;
+    int c;
+    while ((c = this->timedRead()) >= 0 && c != terminator)
+        text.concat((char)c);
+    return text;
+}
+#pragma endregion
+
+#pragma region Serial
+size_t HardwareSerial::write(uint8_t c)
+{
+    return (fputc(c, stdout) == EOF) ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
+#pragma endregion
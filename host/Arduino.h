@@ -0,0 +1,364 @@
+// Arduino core subset for the host build (HOST_ENABLED): String, Print, Stream, Serial, time and random,
+// with the ESP8266 core behaviour the library relies on
+#ifndef FLOKER_HOST_ARDUINO_H
+#define FLOKER_HOST_ARDUINO_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+void randomSeed(unsigned long seed);
+long random(long max);
+long random(long min, long max);
+
+#pragma region String
+class String
+{
+private:
+    std::string buffer;
+
+    static std::string from_integer(unsigned long value, unsigned char base, bool negative);
+    static std::string from_float(double value, unsigned char decimal_places);
+
+public:
+    // Constructor
+    String() {}
+    String(const char *text) : buffer(text ? text : "") {}
+    String(const std::string &text) : buffer(text) {}
+    explicit String(char c) : buffer(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10) : buffer(from_integer(value, base, false)) {}
+    explicit String(int value, unsigned char base = 10) : buffer(from_integer(value < 0 && base == 10 ? -(long)value : (unsigned int)value, base, value < 0 && base == 10)) {}
+    explicit String(unsigned int value, unsigned char base = 10) : buffer(from_integer(value, base, false)) {}
+    explicit String(long value, unsigned char base = 10) : buffer(from_integer(value < 0 && base == 10 ? -(unsigned long)value : (unsigned long)value, base, value < 0 && base == 10)) {}
+    explicit String(unsigned long value, unsigned char base = 10) : buffer(from_integer(value, base, false)) {}
+    explicit String(float value, unsigned char decimal_places = 2) : buffer(from_float(value, decimal_places)) {}
+    explicit String(double value, unsigned char decimal_places = 2) : buffer(from_float(value, decimal_places)) {}
+
+    String &operator=(const char *text)
+    {
+        this->buffer = text ? text : "";
+        return *this;
+    }
+
+    // Capacity: the assignments and concatenations reuse the reserved memory
+    bool reserve(unsigned int size)
+    {
+        this->buffer.reserve(size);
+        return true;
+    }
+    inline unsigned int length() const { return this->buffer.size(); }
+    inline bool isEmpty() const { return this->buffer.empty(); }
+    inline const char *c_str() const { return this->buffer.c_str(); }
+    inline const char *begin() const { return this->buffer.c_str(); }
+    inline const char *end() const { return this->buffer.c_str() + this->buffer.size(); }
+
+    // Concatenation
+    bool concat(const String &text)
+    {
+        this->buffer += text.buffer;
+        return true;
+    }
+    bool concat(const char *text)
+    {
+        if (text == NULL)
+            return false;
+        this->buffer += text;
+        return true;
+    }
+    bool concat(const char *text, unsigned int length)
+    {
+        if (text == NULL)
+            return false;
+        this->buffer.append(text, length);
+        return true;
+    }
+    bool concat(char c)
+    {
+        this->buffer += c;
+        return true;
+    }
+    bool concat(unsigned char value) { return this->concat(String(value)); }
+    bool concat(int value) { return this->concat(String(value)); }
+    bool concat(unsigned int value) { return this->concat(String(value)); }
+    bool concat(long value) { return this->concat(String(value)); }
+    bool concat(unsigned long value) { return this->concat(String(value)); }
+    bool concat(float value) { return this->concat(String(value)); }
+    bool concat(double value) { return this->concat(String(value)); }
+    template <class T>
+    String &operator+=(const T &value)
+    {
+        this->concat(value);
+        return *this;
+    }
+
+    // Comparison
+    inline bool equals(const String &text) const { return this->buffer == text.buffer; }
+    inline bool equals(const char *text) const { return this->buffer == (text ? text : ""); }
+    inline bool equalsIgnoreCase(const String &text) const { return strcasecmp(this->c_str(), text.c_str()) == 0; }
+    inline int compareTo(const String &text) const { return strcmp(this->c_str(), text.c_str()); }
+    inline bool operator==(const String &text) const { return this->equals(text); }
+    inline bool operator==(const char *text) const { return this->equals(text); }
+    inline bool operator!=(const String &text) const { return !this->equals(text); }
+    inline bool operator!=(const char *text) const { return !this->equals(text); }
+    inline bool operator<(const String &text) const { return this->compareTo(text) < 0; }
+    bool startsWith(const String &prefix, unsigned int offset = 0) const
+    {
+        return offset + prefix.length() <= this->length() && this->buffer.compare(offset, prefix.length(), prefix.buffer) == 0;
+    }
+    bool endsWith(const String &suffix) const
+    {
+        return suffix.length() <= this->length() && this->buffer.compare(this->length() - suffix.length(), suffix.length(), suffix.buffer) == 0;
+    }
+
+    // Characters access
+    inline char charAt(unsigned int index) const { return (index < this->length()) ? this->buffer[index] : 0; }
+    inline char operator[](unsigned int index) const { return this->charAt(index); }
+    inline void setCharAt(unsigned int index, char c)
+    {
+        if (index < this->length())
+            this->buffer[index] = c;
+    }
+    void toCharArray(char *destination, unsigned int size, unsigned int index = 0) const
+    {
+        if (size == 0 || index > this->length())
+            return;
+        unsigned int length = this->length() - index;
+        if (length > size - 1)
+            length = size - 1;
+        memcpy(destination, this->c_str() + index, length);
+        destination[length] = 0;
+    }
+
+    // Search
+    int indexOf(char c, unsigned int from = 0) const { return this->to_index(this->buffer.find(c, from)); }
+    int indexOf(const String &text, unsigned int from = 0) const { return this->to_index(this->buffer.find(text.buffer, from)); }
+    int lastIndexOf(char c) const { return this->to_index(this->buffer.rfind(c)); }
+    int lastIndexOf(const String &text) const { return this->to_index(this->buffer.rfind(text.buffer)); }
+    String substring(unsigned int from) const { return this->substring(from, this->length()); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+        {
+            unsigned int swap = from;
+            from = to;
+            to = swap;
+        }
+        if (from >= this->length())
+            return String();
+        if (to > this->length())
+            to = this->length();
+        return String(this->buffer.substr(from, to - from));
+    }
+
+    // Modification
+    void remove(unsigned int index)
+    {
+        if (index < this->length())
+            this->buffer.erase(index);
+    }
+    void remove(unsigned int index, unsigned int count)
+    {
+        if (index < this->length())
+            this->buffer.erase(index, count);
+    }
+    void replace(const String &find, const String &replace)
+    {
+        if (find.length() == 0)
+            return;
+        size_t position = 0;
+        while ((position = this->buffer.find(find.buffer, position)) != std::string::npos)
+        {
+            this->buffer.replace(position, find.length(), replace.buffer);
+            position += replace.length();
+        }
+    }
+    void toLowerCase()
+    {
+        for (size_t k = 0; k < this->buffer.size(); k++)
+            this->buffer[k] = tolower((unsigned char)this->buffer[k]);
+    }
+    void toUpperCase()
+    {
+        for (size_t k = 0; k < this->buffer.size(); k++)
+            this->buffer[k] = toupper((unsigned char)this->buffer[k]);
+    }
+    void trim()
+    {
+        size_t first = this->buffer.find_first_not_of(" \t\r\n\f\v");
+        if (first == std::string::npos)
+        {
+            this->buffer.clear();
+            return;
+        }
+        size_t last = this->buffer.find_last_not_of(" \t\r\n\f\v");
+        this->buffer.erase(last + 1);
+        this->buffer.erase(0, first);
+    }
+
+    // Conversion
+    inline long toInt() const { return atol(this->c_str()); }
+    inline float toFloat() const { return (float)atof(this->c_str()); }
+    inline double toDouble() const { return atof(this->c_str()); }
+
+private:
+    inline int to_index(size_t position) const { return (position == std::string::npos) ? -1 : (int)position; }
+};
+
+// Result of the + operator (used by the libraries to detect the Arduino String)
+class StringSumHelper : public String
+{
+public:
+    StringSumHelper(const String &text) : String(text) {}
+    StringSumHelper(const char *text) : String(text) {}
+};
+
+template <class T>
+inline StringSumHelper operator+(const String &left, const T &right)
+{
+    StringSumHelper sum(left);
+    sum.concat(right);
+    return sum;
+}
+inline StringSumHelper operator+(const char *left, const String &right)
+{
+    StringSumHelper sum(left);
+    sum.concat(right);
+    return sum;
+}
+inline StringSumHelper operator+(char left, const String &right)
+{
+    StringSumHelper sum = String(left);
+    sum.concat(right);
+    return sum;
+}
+#pragma endregion
+
+#pragma region Print
+class Print;
+
+class Printable
+{
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print &print) const = 0;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t nb_written = 0;
+        while (size-- > 0 && this->write(*buffer++) == 1)
+            nb_written++;
+        return nb_written;
+    }
+    size_t write(const char *text) { return (text == NULL) ? 0 : this->write((const uint8_t *)text, strlen(text)); }
+    size_t write(const char *buffer, size_t size) { return this->write((const uint8_t *)buffer, size); }
+    virtual void flush() {}
+
+    size_t print(const String &text) { return this->write(text.c_str(), text.length()); }
+    size_t print(const char *text) { return this->write(text); }
+    size_t print(char c) { return this->write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return this->print(String(value, base)); }
+    size_t print(int value, int base = DEC) { return this->print(String(value, base)); }
+    size_t print(unsigned int value, int base = DEC) { return this->print(String(value, base)); }
+    size_t print(long value, int base = DEC) { return this->print(String(value, base)); }
+    size_t print(unsigned long value, int base = DEC) { return this->print(String(value, base)); }
+    size_t print(double value, int digits = 2) { return this->print(String(value, digits)); }
+    size_t print(const Printable &printable) { return printable.printTo(*this); }
+
+    size_t println() { return this->write("\r\n"); }
+    template <class T>
+    size_t println(const T &value)
+    {
+        size_t nb_written = this->print(value);
+        return nb_written + this->println();
+    }
+    template <class T>
+    size_t println(const T &value, int format)
+    {
+        size_t nb_written = this->print(value, format);
+        return nb_written + this->println();
+    }
+};
+#pragma endregion
+
+#pragma region Stream
+// The reads wait for the data up to the timeout, as on the boards
+class Stream : public Print
+{
+protected:
+    unsigned long timeout = 1000;
+
+    int timedRead();
+    int timedPeek();
+
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    inline void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+    inline unsigned long getTimeout() const { return this->timeout; }
+
+    // Read until the target is found (true) or the terminator / the timeout (false)
+    bool find(const char *target) { return this->findUntil(target, NULL); }
+    bool find(char target)
+    {
+        char text[2] = {target, 0};
+        return this->find(text);
+    }
+    bool findUntil(const char *target, const char *terminator);
+
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return this->readBytes((char *)buffer, length); }
+    size_t readBytesUntil(char terminator, char *buffer, size_t length);
+    String readString();
+    String readStringUntil(char terminator);
+};
+#pragma endregion
+
+#pragma region Serial
+// Console output of the host
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baudrate) { (void)baudrate; }
+    void end() {}
+    operator bool() { return true; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+extern HardwareSerial Serial;
+#pragma endregion
+
+#endif
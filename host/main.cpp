@@ -0,0 +1,18 @@
+#include "Arduino.h"
+
+// Entry point of the sketches built for the host: setup() then FLOKER_HOST_LOOPS times loop() (0: forever)
+#ifndef FLOKER_HOST_LOOPS
+#define FLOKER_HOST_LOOPS 1
+#endif
+
+void setup();
+void loop();
+
+int main()
+{
+    setup();
+    for (unsigned long k = 0; FLOKER_HOST_LOOPS == 0 || k < FLOKER_HOST_LOOPS; k++)
+        loop();
+    Serial.flush();
+    return 0;
+}